@@ -14,21 +14,38 @@ const char *usage =
 "  -v | --verbose     print verbose messages\n"
 "\n"
 "  -c <limit>         set conflict limit\n"
+"  --pure             enable pure literal elimination\n"
+"  --heuristic <name> decision heuristic 'index' (default), 'dlis',\n"
+"                     'moms' or 'jw' (two-sided Jeroslow-Wang)\n"
+"  --no-simd          use scalar instead of AVX2 counter updates\n"
+"                     (always scalar if not compiled for AVX2)\n"
 "\n"
 "and '<dimacs>' is the input file in DIMACS format.  The solver\n"
 "reads from '<stdin>' if no input file is specified.\n";
 
 // clang-format on
 
+// Counter updates use AVX2 gathers if the compiler targets AVX2, e.g., if
+// configured with './configure --native', unless 'NSIMD' is defined.
+
+#if defined(__AVX2__) && !defined(NSIMD)
+#define SIMD
+#endif
+
 #include <algorithm>
 #include <cassert>
 #include <climits>
+#include <cmath>
 #include <cstdarg>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <vector>
 
+#ifdef SIMD
+#include <immintrin.h>
+#endif
+
 // Linux/Unix system specific.
 
 #include <sys/resource.h>
@@ -37,17 +54,27 @@ const char *usage =
 // Global options accessible through the command line.
 
 static bool witness = true;
+static bool pure;  // Assign pure literals.
 
 static int verbosity;  // -1=quiet, 0=normal, 1=verbose, INT_MAX=logging
 
+#ifdef SIMD
+static bool simd = true;  // Use AVX2 counter updates.
+#endif
+
+// Decision heuristics selected with '--heuristic'.
+
+enum Heuristic { INDEX, DLIS, MOMS, JW };
+
+static const char *heuristics[] = {"index", "dlis", "moms", "jw"};
+
+static Heuristic heuristic = INDEX;
+
 // Global options fixed at compile time.
 
 struct Clause {
   unsigned id;	// For debugging and sorting.
   unsigned size;
-  unsigned count;
-  int sum; 
-
   int literals[];
 
   // The following two functions allow simple ranged-based for-loop
@@ -67,7 +94,22 @@ static signed char *values;  // Assignment 0=unassigned,-1=false,1=true.
 static unsigned *levels;     // Maps variables to their level;
 
 static std::vector<Clause *> clauses;
-static std::vector<Clause *> *matrix;
+
+// The occurrence lists in 'matrix' store clause indices instead of clause
+// pointers.  The counters maintained during assigning and unassigning are
+// kept in the dense 'counters' array indexed by these clause indices, such
+// that updating them does not need to access the clauses at all.  Since
+// duplicated literals are removed while parsing, an occurrence list never
+// contains the same clause index twice, which the batched SIMD updates in
+// 'update' rely on.
+
+struct Counter {
+  unsigned count;  // Number of non-false literals.
+  int sum;	   // Sum of non-false literals (the unit if 'count == 1').
+};
+
+static std::vector<unsigned> *matrix;
+static std::vector<Counter> counters;
 
 static Clause *empty_clause;  // Empty clause found.
 
@@ -77,6 +119,40 @@ static int *propagated;	 // The end of the propagated literals.
 
 static std::vector<int *> control;
 
+// Instead of recursing once per decision the search keeps an explicit stack
+// of frames, one per decision level on top of 'control'.  After the first
+// branch of a decision failed, its negation is assigned as 'flipped'
+// decision on a new level, which is backtracked when the second branch
+// fails too.
+
+struct Frame {
+  int decision;  // Decision literal of this level.
+  bool flipped;  // Second branch (negation of original decision).
+};
+
+static std::vector<Frame> frames;
+
+// Except for 'index' all decision heuristics pick literals by scores summed
+// over the clauses without true literal in which they occur, weighted per
+// clause (see 'weight').  Similarly pure literal elimination counts for each
+// literal the clauses without true literal in which it occurs.  To update
+// both incrementally, the number of true literals of each clause is kept in
+// the dense 'trues' array (indexed like 'counters') during assigning and
+// unpropagating, and scores and occurrences change whenever it becomes
+// positive ('satisfy') or drops back to zero ('unsatisfy').
+
+static double *scores;		    // Literal scores over unsatisfied clauses.
+static unsigned *occurs;	    // Unsatisfied clauses per literal.
+static std::vector<unsigned> trues;  // Number of true literals per clause.
+static bool tracking;		    // Maintain 'trues'.
+static bool scoring;		    // Scores initialized and updated.
+static unsigned shortest;	    // Size of shortest non-unit clauses.
+
+// Literals which became pure (no unsatisfied clause contains their negation)
+// are collected here and assigned after propagation (see 'eliminate').
+
+static std::vector<int> candidates;
+
 
 static unsigned level;	   // Decision level.
 
@@ -90,6 +166,7 @@ static size_t conflicts;     // Number of conflicts.
 static size_t decisions;     // Number of decisions.
 static size_t propagations;  // Number of propagated literals.
 static size_t reports;	     // Number of calls to 'report'.
+static size_t pures;	     // Number of assigned pure literals.
 static int fixed;	     // Number of root-level assigned variables.
 
 // Get process-time of this process.  This is not portable to Windows but
@@ -256,7 +333,9 @@ static void initialize(void) {
   unsigned twice = 2 * size;
 
   values = new signed char[twice];
-  matrix = new std::vector<Clause *>[twice];
+  matrix = new std::vector<unsigned>[twice];
+  scores = new double[twice];
+  occurs = new unsigned[twice];
 
   levels = new unsigned[size];
 
@@ -265,8 +344,11 @@ static void initialize(void) {
 
   matrix += variables;
   values += variables;
+  scores += variables;
+  occurs += variables;
 
-  for (int lit = -variables; lit <= variables; lit++) values[lit] = 0;
+  for (int lit = -variables; lit <= variables; lit++)
+    values[lit] = 0, scores[lit] = 0, occurs[lit] = 0;
 
   propagated = assigned = trail = new int[size];
   assert(!level);
@@ -282,9 +364,13 @@ static void release(void) {
 
   matrix -= variables;
   values -= variables;
+  scores -= variables;
+  occurs -= variables;
 
   delete[] matrix;
   delete[] values;
+  delete[] scores;
+  delete[] occurs;
 
   delete[] levels;
 }
@@ -299,6 +385,125 @@ static bool satisfied(Clause *c) {
 
 static bool satisfied() { return assigned - trail == variables; }
 
+// The weight of a clause in the literal scores, which is one for DLIS (thus
+// scores count unsatisfied clauses) and '2^-size' for Jeroslow-Wang.  The
+// latter is capped at size 32 to keep the sums exact under incremental
+// updates.  MOMS is dynamic and weighs by the number of non-false literals
+// in the counter of a clause: it is one for clauses reduced to at most the
+// size of the shortest non-unit input clause (binary for Tseitin encodings)
+// and zero otherwise.
+
+static double weight(Clause *c) {
+  switch (heuristic) {
+    case DLIS:
+      return 1;
+    case MOMS:
+      return counters[c->id].count <= shortest;
+    case JW:
+      return ldexp(1, -(int)std::min(c->size, 32u));
+    default:
+      return 0;
+  }
+}
+
+static void update_scores(Clause *c, double delta) {
+  for (auto lit : *c) scores[lit] += delta;
+}
+
+// For MOMS the counters of the clauses in 'occurrences' are about to gain
+// ('delta = 1') or lose ('delta = -1') a non-false literal, which changes
+// the weight of the unsatisfied ones if they cross the size of the shortest
+// clauses.
+
+static void resize_clauses(const std::vector<unsigned> &occurrences,
+			   int delta) {
+  for (auto idx : occurrences) {
+    if (trues[idx]) continue;
+    unsigned count = counters[idx].count;
+    double before = count <= shortest, after = count + delta <= shortest;
+    if (after != before) update_scores(clauses[idx], after - before);
+  }
+}
+
+// Clause 'idx' got its first true literal.  Its literals lose its weight
+// and an occurrence, which might turn their negations pure.
+
+static void satisfy(unsigned idx) {
+  Clause *c = clauses[idx];
+  if (scoring) update_scores(c, -weight(c));
+  if (pure)
+    for (auto lit : *c)
+      if (!--occurs[lit] && !values[lit]) candidates.push_back(-lit);
+}
+
+// Clause 'idx' lost its last true literal during backtracking.
+
+static void unsatisfy(unsigned idx) {
+  Clause *c = clauses[idx];
+  if (scoring) update_scores(c, weight(c));
+  if (pure)
+    for (auto lit : *c) occurs[lit]++;
+}
+
+// Initialize true literal counts, literal scores and occurrences after
+// parsing, and collect the initially pure literals.
+
+static void init_tracking(void) {
+  scoring = heuristic != INDEX;
+  tracking = scoring || pure;
+  if (!tracking) return;
+  shortest = UINT_MAX;
+  for (auto c : clauses)
+    if (c->size > 1 && c->size < shortest) shortest = c->size;
+  for (auto c : clauses) {
+    unsigned count = 0;
+    for (auto lit : *c)
+      if (values[lit] > 0) count++;
+    trues.push_back(count);
+    if (!count) unsatisfy(c->id);
+  }
+  if (pure)
+    for (int lit = -variables; lit <= variables; lit++)
+      if (lit && !values[lit] && !occurs[-lit]) candidates.push_back(lit);
+  if (scoring) verbose("initialized '%s' scores", heuristics[heuristic]);
+}
+
+// Add 'count' and 'sum' to the counters of all clauses in 'occurrences'.
+// With AVX2 four counters (each a pair of 32-bit words) are gathered with
+// one instruction and updated with one vector addition.  As AVX2 lacks a
+// scatter instruction they are written back one by one, which however hits
+// the cache lines just loaded by the gather.
+
+static void update(const std::vector<unsigned> &occurrences, unsigned count,
+		   int sum) {
+  Counter *counter = counters.data();
+  const unsigned *p = occurrences.data();
+  const unsigned *end = p + occurrences.size();
+#ifdef SIMD
+  if (simd) {
+    const long long *base = (const long long *)counter;
+    const __m256i delta =
+	_mm256_set1_epi64x((long long)((unsigned long long)(unsigned)sum << 32 | count));
+    alignas(32) Counter updated[4];
+    while (end - p >= 4) {
+      __m128i indices = _mm_loadu_si128((const __m128i *)p);
+      __m256i gathered = _mm256_i32gather_epi64(base, indices, sizeof *counter);
+      _mm256_store_si256((__m256i *)updated, _mm256_add_epi32(gathered, delta));
+      counter[p[0]] = updated[0];
+      counter[p[1]] = updated[1];
+      counter[p[2]] = updated[2];
+      counter[p[3]] = updated[3];
+      p += 4;
+    }
+  }
+#endif
+  while (p != end) {
+    Counter &c = counter[*p++];
+    c.count += count;
+    c.sum += sum;
+  }
+}
+
 static void assign(int lit) {
   debug("assign %s", debug(lit));
   // Set 'values[lit]' and 'values[-lit]'.
@@ -311,23 +516,25 @@ static void assign(int lit) {
   // If root-level (so level == 0) increase fixed.
   if(level == 0) 
     fixed++;
-  // Update counter
-
-  for(auto c: matrix[-lit]){
-    debug("before %s", debug(c->count));
-    c->count--;
-    c->sum -= -lit;
-    debug("after %s", debug(c->count));
-    debug("sum of non-false %s", debug(c->sum));
-  }
+  // Update counters of clauses in which '-lit' became false.
+  if (scoring && heuristic == MOMS) resize_clauses(matrix[-lit], -1);
+  update(matrix[-lit], -1, lit);
+  // Update clauses which became satisfied.
+  if (tracking)
+    for (auto idx : matrix[lit])
+      if (!trues[idx]++) satisfy(idx);
 }
 
 static void connect_literal(int lit, Clause *c) {
   debug(c, "connecting %s to", debug(lit));
-  matrix[lit].push_back(c);
+  matrix[lit].push_back(c->id);
 }
 
 static Clause *add_clause(std::vector<int> &literals) {
+  // Remove duplicated literals (see 'update').
+  std::sort(literals.begin(), literals.end());
+  literals.erase(std::unique(literals.begin(), literals.end()), literals.end());
+
   size_t size = literals.size();
   size_t bytes = sizeof(struct Clause) + size * sizeof(int);
   Clause *c = (Clause *)new char[bytes];
@@ -337,22 +544,25 @@ static Clause *add_clause(std::vector<int> &literals) {
 
   assert(clauses.size() <= (size_t)INT_MAX);
   c->size = size;
-  c->count = size;
   int *q = c->literals;
   for (auto lit : literals) {
     *q++ = lit;
   }
   debug(c, "new");
 
+  assert(c->id == clauses.size());
   clauses.push_back(c);	 // Save it on global stack of clauses.
 
-  // Connect the literals of the clause in the matrix.
-  int sum = 0;
+  // Connect the literals of the clause in the matrix and initialize its
+  // counter with the literals not falsified by earlier unit clauses.
+  Counter counter = {0, 0};
   for (auto lit : *c) {
     connect_literal(lit, c);
-    sum += lit;
+    if (values[lit] < 0) continue;
+    counter.count++;
+    counter.sum += lit;
   }
-  c->sum = sum;
+  counters.push_back(counter);
   // Handle the special case of empty and unit clauses.
 
   if (!size) {
@@ -434,23 +644,22 @@ static bool propagate(void) {
     propagations++;
     auto lit = *propagated++;
   
-    for(auto c: matrix[-lit]){
-
-      if(c->count>1){ 
-        continue; 
-        }
-      if(c->count== 1 && values[c->sum] == 1){
-        continue;
+    for (auto idx : matrix[-lit]) {
+      const Counter &c = counters[idx];
+      if (c.count > 1) continue;
+      if (c.count == 1) {
+	signed char value = values[c.sum];
+	if (value > 0) continue;
+	assert(!value);
+	debug(clauses[idx], "forced %s by", debug(c.sum));
+	assign(c.sum);
+      } else {
+	conflicts++;
+	debug(clauses[idx], "conflicting");
+	return false;
       }
-      else if(c->count==1 && values[c->sum] == 0){
-        assign(c->sum);
-      }
-      else {
-        conflicts++;
-        return false;
-      }
-    }
     }
+  }
     
   
   // Propagated next literal 'lit' on trail.
@@ -465,13 +674,40 @@ static bool propagate(void) {
 
 static int is_power_of_two(size_t n) { return n && !(n & (n - 1)); }
 
+// Pick the unassigned literal with the best score.  DLIS picks the literal
+// occurring in most unsatisfied clauses, while MOMS and Jeroslow-Wang pick a
+// variable by the scores of both of its literals and then the phase with
+// the larger score.  Without scores (or ties) the first unassigned variable
+// is picked positively.
+
+static int pick(void) {
+  int res = 0;
+  double best = -1;
+  for (int idx = 1; idx <= variables; idx++) {
+    if (values[idx]) continue;
+    if (!scoring) return idx;
+    double pos = scores[idx], neg = scores[-idx], score;
+    if (heuristic == DLIS)
+      score = std::max(pos, neg);
+    else if (heuristic == MOMS)
+      score = (pos + neg) * 1024 + pos * neg;
+    else
+      score = pos + neg;
+    if (score <= best) continue;
+    res = pos < neg ? -idx : idx;
+    best = score;
+  }
+  return res;
+}
+
 static int decide(void) {
   decisions++;
-  int res = 1;
-  while (assert(res <= variables), values[res]) res++;
+  int res = pick();
+  assert(res);
   level++;
   debug("decide %d", res);
   control.push_back(assigned);
+  frames.push_back({res, false});
   assign(res);
   if (is_power_of_two(decisions)) report('d');
   return res;
@@ -485,13 +721,12 @@ static void unassign(int lit) {
 
 static void unpropagate(int lit) {
   debug("unpropagate %s", debug(lit));
-  // Maintain Counters
- 
-  for(auto c: matrix[-lit]){
-    c->count++;
-    c->sum += -lit;
-
-  }
+  // Maintain counters, in reverse order of 'assign'.
+  if (tracking)
+    for (auto idx : matrix[lit])
+      if (!--trues[idx]) unsatisfy(idx);
+  if (scoring && heuristic == MOMS) resize_clauses(matrix[-lit], 1);
+  update(matrix[-lit], 1, -lit);
 }
 
 static void backtrack() {
@@ -518,20 +753,63 @@ static const int unknown = 0;
 static const int satisfiable = 10;    // Exit code for satisfiable and
 static const int unsatisfiable = 20;  // unsatisfiable formulas.
 
-static int dpll(void) { 
-  for (;;){
-    if(!propagate()) return unsatisfiable;
-    if (limit >= 0 && conflicts >= limit) return unknown;
-    if(satisfied()) return satisfiable;
-    int x = decide();
-    if(dpll() == satisfiable) return satisfiable;
+// Backtrack to the last decision which has not been flipped yet and assign
+// its negation as flipped decision on a new level.  Returns 'false' if all
+// decisions are flipped, i.e., both branches of all decisions failed.
+
+static bool flip(void) {
+  while (!frames.empty()) {
+    Frame frame = frames.back();
+    frames.pop_back();
     backtrack();
-    assign(-x);
+    if (frame.flipped) continue;
+    int lit = -frame.decision;
+    debug("flipping decision %d", frame.decision);
+    level++;
+    control.push_back(assigned);
+    frames.push_back({lit, true});
+    assign(lit);
+    return true;
+  }
+  return false;
+}
+
+// Assign the collected literals which are still pure as implied literals at
+// the current decision level, which undoes them during backtracking.  As
+// pure literals only satisfy clauses, they never lead to a conflict.
+// Returns 'true' if any literal was assigned.
+
+static bool eliminate(void) {
+  bool res = false;
+  while (!candidates.empty()) {
+    int lit = candidates.back();
+    candidates.pop_back();
+    if (values[lit] || occurs[-lit]) continue;
+    debug("pure %s", debug(lit));
+    pures++;
+    assign(lit);
+    res = true;
+  }
+  return res;
+}
+
+static int dpll(void) {
+  for (;;) {
+    if (!propagate()) {
+      candidates.clear();
+      if (!flip()) return unsatisfiable;
+      continue;
+    }
+    if (conflicts >= limit) return unknown;
+    if (eliminate()) continue;
+    if (satisfied()) return satisfiable;
+    decide();
   }
- }
+}
 
 static int solve(void) {
   if (empty_clause) return unsatisfiable;
+  init_tracking();
   return dpll();
 }
 
@@ -581,6 +859,8 @@ static void print_statistics() {
 	 average(decisions, t));
   printf("c %-15s %16zu %12.2f million per second\n",
 	 "propagations:", propagations, average(propagations * 1e-6, t));
+  printf("c %-15s %16zu %12.2f per decision\n", "pure:", pures,
+	 average(pures, decisions));
   printf("c\n");
   printf("c %-15s %16.2f seconds\n", "process-time:", t);
 }
@@ -605,6 +885,25 @@ int main(int argc, char **argv) {
       verbosity = 1;
     else if (!strcmp(arg, "-n") || !strcmp(arg, "--no-witness"))
       witness = false;
+    else if (!strcmp(arg, "-c")) {
+      if (++i == argc) die("argument to '-c' missing");
+      limit = atol(argv[i]);
+    }
+    else if (!strcmp(arg, "--pure"))
+      pure = true;
+    else if (!strcmp(arg, "--heuristic")) {
+      if (++i == argc) die("argument to '--heuristic' missing");
+      int h = 0;
+      while (h != JW && strcmp(argv[i], heuristics[h])) h++;
+      if (strcmp(argv[i], heuristics[h]))
+	die("invalid heuristic '%s' (try '-h')", argv[i]);
+      heuristic = (Heuristic)h;
+    }
+    else if (!strcmp(arg, "--no-simd")) {
+#ifdef SIMD
+      simd = false;
+#endif
+    }
     else if (arg[0] == '-')
       die("invalid option '%s' (try '-h')", arg);
     else if (file_name)
@@ -627,6 +926,11 @@ int main(int argc, char **argv) {
   message("Copyright (c) 2022-2023, Marek Schuster");
   message("Version %s %s", VERSION, GITID);
   message("Compiled with '%s'", BUILD);
+#ifdef SIMD
+  message("%s counter updates", simd ? "AVX2" : "scalar");
+#else
+  message("scalar counter updates");
+#endif
   line();
   message("reading from '%s'", file_name);
 
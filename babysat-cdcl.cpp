@@ -44,7 +44,7 @@ static int verbosity;  // -1=quiet, 0=normal, 1=verbose, INT_MAX=logging
 // Clause data structure.
 
 struct Clause {
-#ifndef NDEBUG
+#if !defined(NDEBUG) || defined(LOGGING)
   size_t id;  // For debugging.
 #endif
   unsigned size;
@@ -66,9 +66,8 @@ static signed char *values;  // Assignment 0=unassigned, -1=false, 1=true.
 static unsigned *levels;     // Maps variables to their level.
 static Clause **reasons;     // Reasons of forced assignments.
 
-static std::vector<int> analyzed;  // Variables analyzed and thus stamped.
-static std::vector<int> learned_clause; // The Clause to be learned
-static size_t *stamped;		   // Maps variables to used time stamps.
+static std::vector<int> conflict_set;  // Decisions the conflict depends on.
+static size_t *stamped;		       // Maps variables to used time stamps.
 
 static std::vector<Clause *> clauses;
 static std::vector<Clause *> *matrix;
@@ -93,7 +92,8 @@ static size_t limit = -1;  // Extends to 'MAX_SIZE_T' ('size_t' unsigned).
 
 static size_t added;	     // Number of added clauses.
 static size_t conflicts;     // Number of conflicts.
-static size_t backjumps;     // Number of backjumped levels.
+static size_t backjumps;     // Number of backjumps (over at least one level).
+static size_t skipped;	     // Number of levels skipped by backjumps.
 static size_t decisions;     // Number of decisions.
 static size_t propagations;  // Number of propagated literals.
 static size_t reports;	     // Number of calls to 'report'.
@@ -285,8 +285,11 @@ static void delete_clause(Clause *c) {
   delete[] c;
 }
 
+static void delete_conflict_sets(unsigned);
+
 static void release(void) {
   for (auto c : clauses) delete_clause(c);
+  delete_conflict_sets(0);
 
   delete[] trail;
 
@@ -336,7 +339,7 @@ static Clause *add_clause(std::vector<int> &literals) {
   Clause *c = (Clause *)new char[bytes];
 
   assert(size <= UINT_MAX);
-#ifndef NDEBUG
+#if !defined(NDEBUG) || defined(LOGGING)
   c->id = added;
 #endif
   added++;
@@ -465,7 +468,6 @@ static void decide(void) {
   level++;
   debug("decide %d", searched);
   control.push_back(assigned);
-  stamped[searched] = 0;
   assign(searched, 0);
   if (is_power_of_two(decisions)) report('d');
 }
@@ -480,8 +482,20 @@ static void unassign(int lit) {
   if (tmp < searched) searched = tmp;
 }
 
+// The first literal on each level is either a decision without reason or
+// a flipped decision whose reason is its conflict set, which is deleted
+// when backtracking over its level.
+
+static void delete_conflict_sets(unsigned new_level) {
+  for (unsigned i = new_level; i < level; i++) {
+    Clause *reason = reasons[abs(*control[i])];
+    if (reason) delete_clause(reason);
+  }
+}
+
 static void backtrack(unsigned new_level) {
   assert(new_level < level);
+  delete_conflict_sets(new_level);
   int *before = control[new_level];
   while (assigned != before) unassign(*--assigned);
   control.resize(new_level);
@@ -489,95 +503,87 @@ static void backtrack(unsigned new_level) {
   level = new_level;
 }
 
-// Heads up: This "solution" is not working at all ...
-// I suffer from insomnia at the moment so please excuse my garbage code
-// Still handing it in ofcourse as i tried my best, but i got confused a lot
-// between the lecture and the information in the forum. 
+// Conflict-directed backjumping without clause learning.  Analyzing a
+// conflict determines the set of decisions it depends on by following the
+// reasons of the stamped literals backward on the trail.  If that set is
+// empty the formula is unsatisfiable.  Otherwise the search backjumps to the
+// level of the last decision in the set, skipping all later levels, which
+// are irrelevant for the conflict, and assigns the negation of the decision
+// on that level.  As reason of this flipped decision the negations of the
+// decisions in the conflict set form a clause, which is not added to the
+// formula but only kept while the flipped decision stays assigned (see
+// 'backtrack').  Thus when later conflicts depend on the flipped decision,
+// their conflict sets include the decisions in its conflict set, and memory
+// usage stays bounded by the number of levels squared.
+
+static unsigned pending;  // Stamped but not yet analyzed literals.
 
 static void analyze_literal(int lit) {
   int idx = abs(lit);
-  assert(values[lit]);
+  assert(values[lit] < 0);
   if (!levels[idx]) return;
   if (stamped[idx] == conflicts) return;
   debug("analyzing literal %s", debug(lit));
-  assert(values[lit] < 0);
-  // stamp literals in the reason clause using the conflict as first reason.
   stamped[idx] = conflicts;
-  if(levels[idx] < level) learned_clause.push_back(lit);
-  if (reasons[idx]) analyzed.push_back(idx);
+  pending++;
 }
-// 'analyze' funtion which gets the conflict as argument.
-static void analyze(Clause *c) {
+
+// Returns 'false' if the conflict does not depend on any decision.
+
+static bool analyze(Clause *c) {
   debug(c, "analyzing conflict %zu", conflicts);
-  learned_clause.clear();
+  assert(!pending);
+  assert(conflict_set.empty());
   for (auto lit : *c) analyze_literal(lit);
-
-  int uip = 0;
-  // Then continue finding on the trail a literal which was recently stamped.
-  // ↑ i think i interpreted this wrong, i also get prime4 unsat so there seems to be an error with my 3. 
-  // I have a lot of trouble with understanding what the statement actually means, forum didn't help
-  while (!analyzed.empty()) {
-    unsigned idx = analyzed.back();
-    analyzed.pop_back();
+  int *p = assigned;
+  while (pending) {
+    assert(p > trail);
+    int lit = *--p;
+    int idx = abs(lit);
+    if (stamped[idx] != conflicts) continue;
+    pending--;
     Clause *reason = reasons[idx];
-    // Alternatively you can just go until the decision of the current level (and use that as UIP).
-    if (!reason && levels[idx] == level){
-      uip = *control[level];
-      //debug("decision as uip %s", uip);
-      break;
-    }
-    if (!reason) continue;
-    debug(c, "analyzing %s reason", debug(values[idx] > 0 ? idx : -idx));
-    for (auto lit : *reason) analyze_literal(lit);
-    
-    // if the number of analyzed literals on the current level 
-    // becomes one it is the UIP and stop traversal.
-    int count = 0;
-    int last_lit = 0;
-    for (auto lit : analyzed){
-      if(levels[abs(lit)] == level){
-        count++;
-        last_lit = lit;
-      }
-    }
-    if(count == 1){
-      assert(last_lit != 0);
-      uip = last_lit;
-      //debug("found uip %s", uip);
-      break;
-    }
+    if (reason) {
+      debug(reason, "analyzing %s reason", debug(lit));
+      for (auto other : *reason)
+	if (other != lit) analyze_literal(other);
+    } else
+      conflict_set.push_back(lit);
   }
-  // This makes the first few tests work but i think it normaly shouldnt be needed (or better said it's probably needed for cdcl that this if is not there)
-  // Seems to be some error in my loop
-  if(uip == 0){
-    uip = *control.back();
-  }
-  // All stamped ilterals on lower levels as well as the UIP give
-  // you the learned clause.
-  assert(stamped[abs(uip)]);
-  learned_clause.push_back(uip);
-  //add_clause(learned_clause);
-  unsigned backtrack_level = level - 1;
-  unsigned backjump_level= 0;
-  int flip = uip;
-  // Find the backjump level as the 
-  // largest other level (different from current level) in that clause
-  for(auto lit : learned_clause){
-    if(levels[abs(lit)] < level && levels[abs(lit)] > backjump_level) backjump_level = levels[abs(lit)];
-  }
-  // in case that l_c is only the uip backjump_level would be 0, think we would need to prevent that
-  if(!backjump_level) backjump_level = backtrack_level;
-
-  unsigned jumped_levels = backtrack_level - backjump_level;
-  if (jumped_levels) {
-    debug("backjumping over %u levels to level %d to flip %s", jumped_levels,
-	  backjump_level, debug(flip));
+  if (conflict_set.empty()) return false;
+
+  // The decisions are collected backward on the trail, thus the first one
+  // is the decision on the highest level.
+
+  int decision = conflict_set[0];
+  unsigned jump = levels[abs(decision)];
+  assert(jump);
+  assert(jump <= level);
+  if (jump < level) {
+    debug("backjumping over %u levels to flip %s", level - jump,
+	  debug(decision));
+    skipped += level - jump;
     backjumps++;
   } else
-    debug("backtracking to level %d to flip %s", backtrack_level, debug(flip));
-  // Backtrack to that level and assign the UIP to its opposite value (flip it).
-  backtrack(backjump_level);
-  assign(-flip, 0);
+    debug("backtracking to flip %s", debug(decision));
+
+  size_t size = conflict_set.size();
+  size_t bytes = sizeof(struct Clause) + size * sizeof(int);
+  Clause *reason = (Clause *)new char[bytes];
+#if !defined(NDEBUG) || defined(LOGGING)
+  reason->id = added + conflicts;
+#endif
+  reason->size = size;
+  int *q = reason->literals;
+  for (auto lit : conflict_set) *q++ = -lit;
+  conflict_set.clear();
+
+  backtrack(jump - 1);
+  level++;
+  control.push_back(assigned);
+  assign(-decision, reason);
+  debug(reason, "flipped %s with conflict set", debug(-decision));
+  return true;
 }
 
 // The SAT competition standardized exit codes (the 'exit (code)' or 'return
@@ -592,8 +598,7 @@ static int solve(void) {
   for (;;) {
     Clause *conflict = propagate();
     if (conflict) {
-      if (!level) return unsatisfiable;
-      analyze(conflict);
+      if (!level || !analyze(conflict)) return unsatisfiable;
     } else if (satisfied())
       return satisfiable;
     else if (conflicts >= limit)
@@ -652,6 +657,8 @@ static void print_statistics() {
 	 average(decisions, t));
   printf("c %-15s %16zu %12.2f %% conflicts\n", "backjumps:", backjumps,
 	 percent(backjumps, conflicts));
+  printf("c %-15s %16zu %12.2f per backjump\n", "skipped:", skipped,
+	 average(skipped, backjumps));
   printf("c %-15s %16zu %12.2f million per second\n",
 	 "propagations:", propagations, average(propagations * 1e-6, t));
   printf("c\n");
@@ -732,7 +739,7 @@ int main(int argc, char **argv) {
   else
     close_file = true;
 
-  message("BabySAT CDCL SAT Solver");
+  message("BabySAT Backjumping SAT Solver");
   line();
   message("Copyright (c) 2022-2023, Marek Schuster");
   message("Version %s %s", VERSION, GITID);
@@ -13,6 +13,9 @@ const char *usage =
 "  -n | --no-witness  do not print witness if satisfiable\n"
 "  -v | --verbose     print verbose messages\n"
 "\n"
+"  --heuristic <name> decision heuristic 'index' (default), 'dlis',\n"
+"                     'moms' or 'jw' (two-sided Jeroslow-Wang)\n"
+"\n"
 "and '<dimacs>' is the input file in DIMACS format.  The solver\n"
 "reads from '<stdin>' if no input file is specified.\n";
 
@@ -21,6 +24,7 @@ const char *usage =
 #include <algorithm>
 #include <cassert>
 #include <climits>
+#include <cmath>
 #include <cstdarg>
 #include <cstdio>
 #include <cstdlib>
@@ -38,11 +42,21 @@ static bool witness = true;
 
 static int verbosity;  // -1=quiet, 0=normal, 1=verbose, INT_MAX=logging
 
+// Decision heuristics selected with '--heuristic'.
+
+enum Heuristic { INDEX, DLIS, MOMS, JW };
+
+static const char *heuristics[] = {"index", "dlis", "moms", "jw"};
+
+static Heuristic heuristic = INDEX;
+
 // Global options fixed at compile time.
 
 struct Clause {
   unsigned id;	// For debugging and sorting.
   unsigned size;
+  unsigned satisfied;  // Number of true literals.
+  unsigned unfalsified;  // Number of non-false literals (only for MOMS).
   int literals[];
 
   // The following two functions allow simple ranged-based for-loop
@@ -64,10 +78,33 @@ static std::vector<Clause *> clauses;
 static std::vector<Clause *> *matrix;
 
 static Clause *empty_clause;  // Empty clause found.
+static size_t unsatisfied;    // Number of clauses without true literal.
 
 static std::vector<int> trail;
 static std::vector<size_t> control;
 
+// Instead of recursing once per decision the search keeps an explicit stack
+// of frames, one per decision level on top of 'control'.  After the first
+// branch of a decision failed, its negation is assigned as 'flipped'
+// decision on a new level, which is backtracked when the second branch
+// fails too.
+
+struct Frame {
+  int decision;  // Decision literal of this level.
+  bool flipped;  // Second branch (negation of original decision).
+};
+
+static std::vector<Frame> frames;
+
+// Except for 'index' all decision heuristics pick literals by scores summed
+// over the clauses without true literal in which they occur, weighted per
+// clause (see 'weight').  These scores are updated incrementally whenever a
+// clause becomes satisfied or unsatisfied in 'assign' and 'unassign'.
+
+static double *scores;	   // Literal scores over unsatisfied clauses.
+static bool scoring;	   // Scores initialized and updated.
+static unsigned shortest;  // Size of shortest non-unit clauses for MOMS.
+
 static unsigned level;	   // Decision level.
 static size_t propagated;  // Next position on trail to propagate.
 
@@ -247,6 +284,7 @@ static void initialize(void) {
 
   values = new signed char[twice];
   matrix = new std::vector<Clause *>[twice];
+  scores = new double[twice];
 
   levels = new unsigned[size];
 
@@ -255,8 +293,10 @@ static void initialize(void) {
 
   matrix += variables;
   values += variables;
+  scores += variables;
 
-  for (int lit = -variables; lit <= variables; lit++) values[lit] = 0;
+  for (int lit = -variables; lit <= variables; lit++)
+    values[lit] = 0, scores[lit] = 0;
 
   assert(!propagated);
   assert(!level);
@@ -272,26 +312,83 @@ static void release(void) {
 
   matrix -= variables;
   values -= variables;
+  scores -= variables;
 
   delete[] matrix;
   delete[] values;
+  delete[] scores;
 
   delete[] levels;
 }
 
+// The weight of a clause in the literal scores, which is one for DLIS (thus
+// scores count unsatisfied clauses) and '2^-size' for Jeroslow-Wang.  The
+// latter is capped at size 32 to keep the sums exact under incremental
+// updates.  MOMS is dynamic and weighs by the current number of non-false
+// literals of a clause: it is one for clauses reduced to at most the size
+// of the shortest non-unit input clause (binary for Tseitin encodings) and
+// zero otherwise.
+
+static double weight(Clause *c) {
+  switch (heuristic) {
+    case DLIS:
+      return 1;
+    case MOMS:
+      return c->unfalsified <= shortest;
+    case JW:
+      return ldexp(1, -(int)std::min(c->size, 32u));
+    default:
+      return 0;
+  }
+}
+
+static void update_scores(Clause *c, double delta) {
+  for (auto lit : *c) scores[lit] += delta;
+}
+
+// For MOMS the clauses in 'occurrences' gain ('delta = 1') or lose ('delta
+// = -1') a non-false literal, which changes the weight of the unsatisfied
+// ones if they cross the size of the shortest clauses.
+
+static void resize_clauses(std::vector<Clause *> &occurrences, int delta) {
+  for (auto c : occurrences) {
+    double before = weight(c);
+    c->unfalsified += delta;
+    if (c->satisfied) continue;
+    double after = weight(c);
+    if (after != before) update_scores(c, after - before);
+  }
+}
+
+// Initialize the literal scores after parsing from all clauses without true
+// literal (satisfied clauses change during search only).
+
+static void init_scores(void) {
+  if (heuristic == INDEX) return;
+  shortest = UINT_MAX;
+  for (auto c : clauses) {
+    if (c->size > 1 && c->size < shortest) shortest = c->size;
+    c->unfalsified = 0;
+    for (auto lit : *c)
+      if (values[lit] >= 0) c->unfalsified++;
+  }
+  for (auto c : clauses)
+    if (!c->satisfied) update_scores(c, weight(c));
+  scoring = true;
+  verbose("initialized '%s' scores", heuristics[heuristic]);
+}
+
 static bool satisfied(Clause *c) {
   for (auto lit : *c)
     if (values[lit] > 0) return true;
   return false;
 }
 
-// Check whether all clauses are satisfied.
+// Check whether all clauses are satisfied, which with the true literal
+// counters of the clauses (maintained in 'assign' and 'unassign') boils
+// down to checking that no clause without true literal is left.
 
-static bool satisfied() { 
-  //from lecture: for (auto c: Clause)
-  for(auto c : clauses)
-    if (!satisfied(c)) return false;
-  return true; }
+static bool satisfied() { return !unsatisfied; }
 
 static void assign(int lit) {
   debug("assign %s", debug(lit));
@@ -308,6 +405,14 @@ static void assign(int lit) {
   // If root-level (so level == 0) increase fixed.
   if(level == 0) 
     fixed++;
+  // For MOMS update the non-false literal counters of the clauses with '-lit'.
+  if (scoring && heuristic == MOMS) resize_clauses(matrix[-lit], -1);
+  // Update the true literal counters of the clauses with 'lit'.
+  for (auto c : matrix[lit])
+    if (!c->satisfied++) {
+      unsatisfied--;
+      if (scoring) update_scores(c, -weight(c));
+    }
 }
 
 static void connect_literal(int lit, Clause *c) {
@@ -329,6 +434,11 @@ static Clause *add_clause(std::vector<int> &literals) {
   int *q = c->literals;
   for (auto lit : literals) *q++ = lit;
 
+  c->satisfied = 0;
+  for (auto lit : *c)
+    if (values[lit] > 0) c->satisfied++;
+  if (!c->satisfied) unsatisfied++;
+
   debug(c, "new");
 
   clauses.push_back(c);	 // Save it on global stack of clauses.
@@ -412,70 +522,73 @@ static void parse(void) {
 // then assign the forced literal by that unit clause.
 
 static bool propagate(void) {
-  // While not all literals propagated.
-  //int i = 0;
-  while (propagated < trail.size())
-  {
+  while (propagated < trail.size()) {
     propagations++;
     auto lit = trail[propagated++];
-    
-    for(auto c: matrix[-lit]){
-
-      //check satisfied
-      if(satisfied(c))
-        continue;
-      //check falsified / forcing
-      
-      int unassigned = 0;
-      int unassigned_lit;
-      for(auto literal: *c){
-        if(values[literal] == 0){
-          unassigned++;
-          unassigned_lit = literal;
-        }
+    debug("propagating %s", debug(lit));
+    // Go over all clauses in which '-lit' occurs.
+    for (auto c : matrix[-lit]) {
+      // Satisfied clauses are skipped in constant time.
+      if (c->satisfied) continue;
+      // Otherwise all literals are false or unassigned, and scanning the
+      // clause stops as soon as a second unassigned literal is found.
+      int unit = 0;
+      for (auto other : *c) {
+	if (values[other]) continue;
+	if (unit) goto NEXT_CLAUSE;
+	unit = other;
       }
-      switch (unassigned)
-      {
-      case 0:       //falsified
-        conflicts++;
-        return false;
-      case 1:       //forcing
-        assign(unassigned_lit);
-        break;
-      default:
-        continue;
+      if (!unit) {
+	conflicts++;
+	debug(c, "conflicting");
+	return false;
       }
-      break;
-    }
+      debug(c, "forced %s by", debug(unit));
+      assign(unit);
+    NEXT_CLAUSE:;
     }
-    
-  
-  // Propagated next literal 'lit' on trail.
-  // Increase 'propagations'.
-  // Go over all clauses in which '-lit' occurs.
-  // For each clause check whether it is satisfied, falsified, or forcing.
-  // If clause falsified return 'false' (increase 'conflicts').
-  // If forcing assign the forced unit.
-  // If all literals propagated without finding a falsified clause (conflict):
+  }
   return true;
 }
 
 static int is_power_of_two(size_t n) { return n && !(n & (n - 1)); }
 
+// Pick the unassigned literal with the best score.  DLIS picks the literal
+// occurring in most unsatisfied clauses, while MOMS and Jeroslow-Wang pick a
+// variable by the scores of both of its literals and then the phase with
+// the larger score.  Without scores (or ties) the first unassigned variable
+// is picked positively.
+
+static int pick(void) {
+  int res = 0;
+  double best = -1;
+  for (int idx = 1; idx <= variables; idx++) {
+    if (values[idx]) continue;
+    if (!scoring) return idx;
+    double pos = scores[idx], neg = scores[-idx], score;
+    if (heuristic == DLIS)
+      score = std::max(pos, neg);
+    else if (heuristic == MOMS)
+      score = (pos + neg) * 1024 + pos * neg;
+    else
+      score = pos + neg;
+    if (score <= best) continue;
+    res = pos < neg ? -idx : idx;
+    best = score;
+  }
+  return res;
+}
+
 static int decide(void) {
   decisions++;
-  int res = 0;
   // Find a variable/literal which is not assigned yet.
-  for (int i=1; i<= variables; i++){
-    if(values[i] == 0){
-      res = i;
-      break;
-    } 
-  }
+  int res = pick();
+  assert(res);
   // Increase decision level.
   level++;
   // Save the current trail on the control stack for backtracking.
   control.push_back(trail.size());
+  frames.push_back({res, false});
   // Assign the picked decision literal.
   assign(res);
   if (is_power_of_two(decisions)) report('d');
@@ -487,6 +600,13 @@ static void unassign(int lit) {
   // Reset 'values[lit]' and 'values[-lit]'.
   values[lit] = 0;
   values[-lit] = 0;
+  // Update the true literal counters of the clauses with 'lit'.
+  for (auto c : matrix[lit])
+    if (!--c->satisfied) {
+      unsatisfied++;
+      if (scoring) update_scores(c, weight(c));
+    }
+  if (scoring && heuristic == MOMS) resize_clauses(matrix[-lit], 1);
 }
 
 static void backtrack() {
@@ -513,19 +633,41 @@ static void backtrack() {
 static const int satisfiable = 10;    // Exit code for satisfiable and
 static const int unsatisfiable = 20;  // unsatisfiable formulas.
 
-static int dpll(void) { 
-  for (;;){
-    if(!propagate()) return unsatisfiable;
-    if(satisfied()) return satisfiable;
-    int x = decide();
-    if(dpll() == satisfiable) return satisfiable;
+// Backtrack to the last decision which has not been flipped yet and assign
+// its negation as flipped decision on a new level.  Returns 'false' if all
+// decisions are flipped, i.e., both branches of all decisions failed.
+
+static bool flip(void) {
+  while (!frames.empty()) {
+    Frame frame = frames.back();
+    frames.pop_back();
     backtrack();
-    assign(-x);
+    if (frame.flipped) continue;
+    int lit = -frame.decision;
+    debug("flipping decision %d", frame.decision);
+    level++;
+    control.push_back(trail.size());
+    frames.push_back({lit, true});
+    assign(lit);
+    return true;
   }
- }
+  return false;
+}
+
+static int dpll(void) {
+  for (;;) {
+    if (!propagate()) {
+      if (!flip()) return unsatisfiable;
+      continue;
+    }
+    if (satisfied()) return satisfiable;
+    decide();
+  }
+}
 
 static int solve(void) {
   if (empty_clause) return unsatisfiable;
+  init_scores();
   return dpll();
 }
 
@@ -599,7 +741,14 @@ int main(int argc, char **argv) {
       verbosity = 1;
     else if (!strcmp(arg, "-n") || !strcmp(arg, "--no-witness"))
       witness = false;
-    else if (arg[0] == '-')
+    else if (!strcmp(arg, "--heuristic")) {
+      if (++i == argc) die("argument to '--heuristic' missing");
+      int h = 0;
+      while (h != JW && strcmp(argv[i], heuristics[h])) h++;
+      if (strcmp(argv[i], heuristics[h]))
+	die("invalid heuristic '%s' (try '-h')", argv[i]);
+      heuristic = (Heuristic)h;
+    } else if (arg[0] == '-')
       die("invalid option '%s' (try '-h')", arg);
     else if (file_name)
       die("too many arguments '%s' and '%s' (try '-h')", file_name, arg);
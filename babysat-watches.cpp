@@ -13,13 +13,39 @@ const char *usage =
 "  -n | --no-witness  do not print witness if satisfiable\n"
 "  -v | --verbose     print verbose messages\n"
 "\n"
+"  --no-inprocessing  disable simplification during search\n"
+"  --inprocess-interval <n>\n"
+"                     run inprocessing passes first after <n> conflicts\n"
+"  --renumber         renumber variables for memory locality\n"
+"  --compress         compress long learned clauses\n"
+"  --huge-pages       back large arrays and clauses by huge pages\n"
+"\n"
 "  -c <limit>         set conflict limit\n"
+"  --tick-limit <n>   set propagation tick limit (deterministic)\n"
+"  --time-limit <s>   set process time limit in seconds\n"
+"\n"
+"  --record <trace>   record decisions and learned clauses to '<trace>'\n"
+"  --replay <trace>   replay '<trace>' measuring only propagation\n"
 "\n"
 "and '<dimacs>' is the input file in DIMACS format.  The solver\n"
 "reads from '<stdin>' if no input file is specified.\n";
 
 // clang-format on
 
+// The search for replacement watches in long clauses uses AVX2 gathers if
+// the compiler targets AVX2, e.g., if configured with './configure
+// --native', unless 'NSIMD' is defined.
+
+#if defined(__AVX2__) && !defined(NSIMD) && !defined(PACKED)
+#define SIMD
+#endif
+
+// Experimentally, compiling with '-DPACKED' stores the assignment with two
+// bits per variable instead of one byte per literal, which quarters the
+// size of the value array at the cost of masking and shifting on every
+// lookup.  The AVX2 replacement search is disabled in this mode since it
+// gathers byte values.
+
 #include <algorithm>
 #include <cassert>
 #include <climits>
@@ -28,29 +54,48 @@ const char *usage =
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <ctime>
+#include <new>
 #include <vector>
 
+#ifdef SIMD
+#include <immintrin.h>
+#endif
+
 // Linux/Unix system specific.
 
+#include <sys/mman.h>
 #include <sys/resource.h>
 #include <sys/time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
 
 // Global options accessible through the command line.
 
 static bool witness = true;
+static bool inprocessing = true;
+static bool renumber;
+static bool compress;
+static bool huge_pages;
 
 static int verbosity;  // -1=quiet, 0=normal, 1=verbose, INT_MAX=logging
 
 // Clause data structure.
 
 struct Clause {
-#ifndef NDEBUG
+#if !defined(NDEBUG) || defined(LOGGING)
   size_t id;  // For debugging.
 #endif
   unsigned size;
   int watch1 = 0;
   int watch2 = 0; 
   int blocker = 0;
+  unsigned position = 0;  // Where the last replacement watch was found.
+  unsigned encoded = 0;   // Bytes of compressed literals (zero if plain).
   int literals[];
   
   // The following two functions allow simple ranged-based for-loop
@@ -60,38 +105,213 @@ struct Clause {
   //   for (auto lit : *c)
   //     do_something_with (lit);
   //
-  int *begin() { return literals; }
-  int *end() { return literals + size; }
+  // For compressed clauses 'begin' decodes the literals into a global
+  // buffer, which is overwritten by decoding the next compressed clause.
+  //
+  int *begin();
+  int *end();
 };
 
 static int variables;        // Variable range: 1 .. <variables>.
+#ifdef PACKED
+static unsigned char *values;  // Two bits per variable (see 'val').
+#else
 static signed char *values;  // Assignment 0=unassigned, -1=false, 1=true.
+#endif
 static unsigned *levels;     // Maps variables to their level.
 static Clause **reasons;     // Reasons of forced assignments.
 
-static std::vector<int> analyzed;  // Variables analyzed and thus stamped.
-static size_t *stamped;            // Maps variables to used time stamps.
+static std::vector<int> analyzed;  // Variables analyzed and thus marked.
+static std::vector<int> learned;   // Learned clause (reused).
+
+static std::vector<int> decode_buffer;            // Decoded literals.
+static std::vector<unsigned char> encode_buffer;  // Encoded literals.
+static unsigned char *marks;       // Maps variables to analysis marks.
+
+// The value of a literal is 0 if unassigned, -1 if false and 1 if true.
+// In packed mode the two bits of a variable hold the value of its positive
+// literal as two's complement number (1=true, 3=false), which is sign
+// extended and then negated for negative literals without branching.
+
+static inline int val(int lit) {
+#ifdef PACKED
+  unsigned idx = abs(lit);
+  unsigned bits = values[idx >> 2] >> (2 * (idx & 3));
+  int res = (int)(bits << 30) >> 30;
+  int sign = lit >> 31;
+  return (res ^ sign) - sign;
+#else
+  return values[lit];
+#endif
+}
+
+static inline void set_val(int lit) {
+#ifdef PACKED
+  unsigned idx = abs(lit);
+  values[idx >> 2] |= (lit < 0 ? 3u : 1u) << (2 * (idx & 3));
+#else
+  values[lit] = 1;
+  values[-lit] = -1;
+#endif
+}
+
+static inline void reset_val(int lit) {
+#ifdef PACKED
+  unsigned idx = abs(lit);
+  values[idx >> 2] &= ~(3u << (2 * (idx & 3)));
+#else
+  values[lit] = values[-lit] = 0;
+#endif
+}
+
+// Ternary clauses are watched in separate watch lists, whose entries store
+// the two other literals inline.  Unless both other literals are unassigned
+// and the watch has to move, propagating them does not access clause
+// memory.  The clause pointer is otherwise only used as reason or conflict.
+// Keeping them apart from the watches of the other clauses keeps those
+// lists compact.
+
+struct Ternary {
+  int other1, other2;
+  Clause *clause;
+};
+
+// The occurrence and watch lists of all literals are segments of a single
+// pool per kind of list instead of separately allocated vectors.  A list
+// which outgrows its segment is moved to the end of the pool with twice
+// the capacity, unless it ends there already and grows in place.  The
+// segments left behind are garbage, which 'compact' removes by copying
+// the lists in literal order into a fresh pool, keeping their capacity.
+// Pushing to a list may move the pool and thus invalidates pointers into
+// all lists of that kind.
+
+struct Segment {
+  size_t start;
+  unsigned size, capacity;
+};
+
+template <class T> struct Lists {
+  Segment *segments;     // Indexed by literals.
+  T *pool = 0;           // Entries of all lists.
+  size_t used = 0;       // Entries in segments (including garbage).
+  size_t allocated = 0;  // Allocated entries.
+  size_t garbage = 0;    // Entries in abandoned segments.
+
+  T *begin(int lit) { return pool + segments[lit].start; }
+  T *end(int lit) { return begin(lit) + segments[lit].size; }
+  unsigned size(int lit) const { return segments[lit].size; }
+  void resize(int lit, unsigned size) { segments[lit].size = size; }
+  void clear(int lit) { segments[lit].size = 0; }
+
+  void push_back(int lit, const T &element) {
+    Segment &segment = segments[lit];
+    if (segment.size == segment.capacity) grow(segment);
+    pool[segment.start + segment.size++] = element;
+  }
+
+  void grow(Segment &segment) {
+    unsigned capacity = segment.capacity ? 2 * segment.capacity : 2;
+    if (segment.start + segment.capacity == used) {
+      reserve(segment.start + capacity);
+      used = segment.start + capacity;
+    } else {
+      size_t start = used;
+      reserve(start + capacity);
+      used = start + capacity;
+      std::copy(pool + segment.start, pool + segment.start + segment.size,
+                pool + start);
+      garbage += segment.capacity;
+      segment.start = start;
+    }
+    segment.capacity = capacity;
+  }
+
+  // These allocate and release the pool with 'allocate_array' and
+  // 'delete_array' below, such that it is backed by huge pages too.
+
+  void reserve(size_t entries);
+  void compact(int variables);
+  void release();
+};
 
 static std::vector<Clause *> clauses;
-static std::vector<Clause *> *matrix;
-static std::vector<Clause *> *watched;
+static Lists<Clause *> matrix;
+static Lists<Clause *> watched;
+static Lists<Ternary> ternary;
 
 
 static Clause *empty_clause;  // Empty clause found.
 
+// Clauses are allocated from arenas, i.e., large chunks of memory, by
+// bumping a pointer.  If the current arena is full a new one twice as large
+// is started.  Deleted clauses and literals removed from clauses leave
+// garbage in the arenas, which is reclaimed by compacting all clauses into
+// a fresh arena during simplification.  Clauses are copied in the order in
+// which they are reached from the watch lists, such that clauses visited
+// together during propagation are close in memory.
+
+struct Arena {
+  char *begin, *top, *end;
+};
+
+static std::vector<Arena> arenas;  // The last one is the current one.
+static size_t arena_bytes;         // Allocated bytes in all arenas.
+
 // Using a fixed size trail makes propagation and backtracking faster.
 
 static int *trail;       // The start of the assigned literals.
 static int *assigned;    // The end of the assigned literals.
 static int *propagated;  // The end of the propagated literals.
 
-static std::vector<int *> control;
+// The control stack has one entry per decision level including the root
+// level, which holds its decision, the trail position where the level
+// starts and during conflict analysis the number of literals of the
+// learned clause on that level (see 'analyze').  Backtracking uses the
+// decision to restart the search for unassigned variables (see 'decide').
+
+struct Level {
+  int decision;
+  unsigned trail;
+  unsigned seen;
+};
+
+static std::vector<Level> control;
+
+// With '--renumber' variables are renumbered after parsing.  The solver
+// works on internal variables and these maps translate between them and
+// the external variables of the DIMACS file.  Both are zero otherwise.
+
+static int *internal;  // Maps external to internal variables.
+static int *external;  // Maps internal to external variables.
 
 static unsigned level;  // Decision level.
 
-// Conflict limit.
+// Conflict, tick and time limits.
+
+static size_t limit = -1;       // Extends to 'MAX_SIZE_T' ('size_t' unsigned).
+static size_t tick_limit = -1;  // Same for the propagation ticks.
+static double time_limit;       // Process time limit (zero if unlimited).
+
+// Propagation effort is measured in ticks, which count visited watches and
+// cache lines of clause memory touched.  Unlike conflicts their number is
+// roughly proportional to running time, and unlike time it is reproducible.
+
+static const size_t cache_line_bytes = 64;
+
+// While traversing watch lists the clause of the watch 'PREFETCH' positions
+// ahead is prefetched, i.e., its header and first literals, which share a
+// cache line.  Compile with '-DPREFETCH=0' to disable prefetching.
+
+#ifndef PREFETCH
+#define PREFETCH 4
+#endif
+
+// Recording and replaying decisions and learned clauses ('--record' and
+// '--replay') allows to benchmark propagation and backtracking alone.
 
-static size_t limit = -1;  // Extends to 'MAX_SIZE_T' ('size_t' unsigned).
+static const char *record_path;
+static const char *replay_path;
+static FILE *record_file;
 
 // Statistics:
 
@@ -100,8 +320,73 @@ static size_t conflicts;     // Number of conflicts.
 static size_t backjumps;     // Number of backjumped levels.
 static size_t decisions;     // Number of decisions.
 static size_t propagations;  // Number of propagated literals.
+static size_t ticks;         // Propagation ticks (see above).
+static size_t visits;        // Visited watches during propagation.
+static size_t ternaries;     // Visited watches of ternary clauses.
 static size_t reports;       // Number of calls to 'report'.
 static int fixed;            // Number of root-level assigned variables.
+static size_t inprocessed;   // Propagations during inprocessing.
+static size_t collected;     // Clauses removed by simplification.
+static size_t shrunken;      // Literals removed by simplification.
+static size_t failed;        // Failed literals found by probing.
+static size_t compactions;   // Number of arena compactions.
+static double fragmented;    // Sum of garbage percentages before them.
+static double defragmented;  // Sum of garbage percentages after them.
+static size_t compressed;    // Number of compressed learned clauses.
+static size_t uncompressed;  // Bytes of their literals if not compressed.
+static size_t saved;         // Bytes saved by compressing them.
+static size_t decodes;       // Number of decoded compressed clauses.
+static size_t decoded;       // Literals decoded from compressed clauses.
+static size_t glue;          // Summed glue of learned clauses.
+static size_t maps;          // Memory mappings with huge pages advised.
+static size_t mapped;        // Bytes mapped with huge pages advised.
+
+// With assertion checking enabled all heap allocations through 'new' are
+// counted.  Conflict analysis and backjumping keep their temporary buffers
+// as global vectors reserved for the maximum size and thus are asserted to
+// never allocate.  Only storing learned clauses grows the clause arenas
+// and watch lists now and then, which the 'allocations:' statistics line
+// shows per conflict.
+
+#ifndef NDEBUG
+
+static size_t allocations;         // Heap allocations through 'new'.
+static size_t search_allocations;  // Heap allocations during search.
+
+// All plain, array and 'nothrow' variants are replaced, since library code
+// like 'std::stable_sort' uses the latter and mixing the replaced ones with
+// those of the sanitizers is reported as mismatch.
+
+void *operator new(size_t bytes, const std::nothrow_t &) noexcept {
+  allocations++;
+  return malloc(bytes ? bytes : 1);
+}
+
+void *operator new(size_t bytes) {
+  void *res = operator new(bytes, std::nothrow);
+  if (!res) throw std::bad_alloc();
+  return res;
+}
+
+void *operator new[](size_t bytes) { return operator new(bytes); }
+void *operator new[](size_t bytes, const std::nothrow_t &tag) noexcept {
+  return operator new(bytes, tag);
+}
+
+void operator delete(void *ptr) noexcept { free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+void operator delete(void *ptr, const std::nothrow_t &) noexcept { free(ptr); }
+void operator delete[](void *ptr) noexcept { free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept {
+  free(ptr);
+}
+
+#endif
+
+static size_t backtracks;       // Number of calls to 'backtrack' in replay.
+static double propagate_time;   // Time spent in 'propagate' in replay.
+static double backtrack_time;   // Time spent in 'backtrack' in replay.
 
 // Get process-time of this process.  This is not portable to Windows but
 // should work on other Unixes such as MacOS as is.
@@ -115,6 +400,47 @@ static double process_time(void) {
   return res;
 }
 
+// Monotonic wall-clock time which is cheap enough to be taken around every
+// single call to 'propagate' and 'backtrack' while replaying.
+
+static double wall_clock_time(void) {
+  struct timespec ts;
+  if (clock_gettime(CLOCK_MONOTONIC, &ts)) return 0;
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+static double average(double a, double b) { return b ? a / b : 0; }
+static double percent(double a, double b) { return average(100 * a, b); }
+
+// Data TLB read misses of this process are counted through a hardware
+// performance counter if 'perf_event_open' is available, which depends on
+// the kernel, the hardware and '/proc/sys/kernel/perf_event_paranoid'.
+
+static int dtlb_counter = -1;
+
+static void open_dtlb_counter(void) {
+#ifdef __linux__
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof attr);
+  attr.type = PERF_TYPE_HW_CACHE;
+  attr.size = sizeof attr;
+  attr.config = PERF_COUNT_HW_CACHE_DTLB |
+                PERF_COUNT_HW_CACHE_OP_READ << 8 |
+                PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  dtlb_counter = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+}
+
+static bool read_dtlb_counter(size_t &misses) {
+  unsigned long long count;
+  if (dtlb_counter < 0) return false;
+  if (read(dtlb_counter, &count, sizeof count) != sizeof count) return false;
+  misses = count;
+  return true;
+}
+
 // Report progress once in a while.
 
 static void report(char type) {
@@ -171,7 +497,7 @@ static char *debug(int lit) {
   if (!logging()) return 0;
   char *res = debug_string();
   sprintf(res, "%d", lit);
-  int value = values[lit];
+  int value = val(lit);
   if (value) {
     size_t len = strlen(res);
     size_t remaining = sizeof debug_buffer[0] - len;
@@ -260,58 +586,322 @@ static void die(const char *fmt, ...) {
   exit(1);
 }
 
+// With '--huge-pages' the clause arenas, the list pools and the
+// per-variable and per-literal arrays of at least the size of a huge page
+// are mapped with 'mmap' at huge page boundaries and advised to be backed
+// by transparent huge pages ('MADV_HUGEPAGE').  This reduces TLB misses if
+// they span gigabytes.  If mapping or advising fails the memory is
+// allocated normally instead.
+
+static const size_t huge_page_bytes = (size_t)1 << 21;
+
+struct Mapping {
+  void *start;
+  size_t bytes;
+};
+
+static std::vector<Mapping> mappings;
+
+static void *map_pages(size_t bytes) {
+#ifdef MADV_HUGEPAGE
+  if (!huge_pages || bytes < huge_page_bytes) return 0;
+  bytes = (bytes + huge_page_bytes - 1) & ~(huge_page_bytes - 1);
+  size_t padded = bytes + huge_page_bytes;
+  char *start = (char *)mmap(0, padded, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (start == MAP_FAILED) return 0;
+  char *aligned = (char *)(((size_t)start + huge_page_bytes - 1) &
+                           ~(huge_page_bytes - 1));
+  if (aligned != start) munmap(start, aligned - start);
+  size_t tail = start + padded - (aligned + bytes);
+  if (tail) munmap(aligned + bytes, tail);
+  if (madvise(aligned, bytes, MADV_HUGEPAGE)) {
+    munmap(aligned, bytes);
+    return 0;
+  }
+  mappings.push_back({aligned, bytes});
+  maps++;
+  mapped += bytes;
+  return aligned;
+#else
+  (void)bytes;
+  return 0;
+#endif
+}
+
+static bool is_mapped(void *start) {
+  for (auto &mapping : mappings)
+    if (mapping.start == start) return true;
+  return false;
+}
+
+static void unmap_pages(void *start) {
+  for (auto &mapping : mappings) {
+    if (mapping.start != start) continue;
+    munmap(mapping.start, mapping.bytes);
+    mapping = mappings.back();
+    mappings.pop_back();
+    return;
+  }
+  assert(!"unmapped pages");
+}
+
+// Anonymous mappings are zero initialized, which is all the arrays but
+// those of watch lists need.  Those elements are constructed explicitly.
+
+template <class T> static T *allocate_array(size_t n) {
+  T *res = (T *)map_pages(n * sizeof(T));
+  if (!res) return new T[n]();
+  for (size_t i = 0; i != n; i++) new (res + i) T();
+  return res;
+}
+
+template <class T> static void delete_array(T *a, size_t n) {
+  if (!is_mapped(a)) {
+    delete[] a;
+    return;
+  }
+  for (size_t i = 0; i != n; i++) a[i].~T();
+  unmap_pages(a);
+}
+
+template <class T> void Lists<T>::reserve(size_t entries) {
+  if (entries <= allocated) return;
+  size_t capacity = std::max(entries, 2 * allocated);
+  T *fresh = allocate_array<T>(capacity);
+  std::copy(pool, pool + used, fresh);
+  release();
+  pool = fresh;
+  allocated = capacity;
+}
+
+template <class T> void Lists<T>::compact(int variables) {
+  assert(garbage <= used);
+  size_t capacity = used - garbage;
+  T *fresh = allocate_array<T>(capacity);
+  size_t start = 0;
+  for (int lit = -variables; lit <= variables; lit++) {
+    Segment &segment = segments[lit];
+    std::copy(begin(lit), end(lit), fresh + start);
+    segment.start = start;
+    start += segment.capacity;
+  }
+  assert(start == capacity);
+  release();
+  pool = fresh;
+  used = allocated = capacity;
+  garbage = 0;
+}
+
+template <class T> void Lists<T>::release() {
+  if (pool) delete_array(pool, allocated);
+  pool = 0;
+  allocated = 0;
+}
+
 static void initialize(void) {
   assert(variables < INT_MAX);
   unsigned size = variables + 1;
 
   unsigned twice = 2 * size;
 
-  values = new signed char[twice]();
-  matrix = new std::vector<Clause *>[twice];
-  watched = new std::vector<Clause *>[twice];
+  // The SIMD replacement search gathers the values of literals as 32-bit
+  // words and thus reads up to three bytes past the last value.  Packed
+  // values are indexed by variable and fit four variables into a byte.
+
+#ifdef PACKED
+  values = allocate_array<unsigned char>(size / 4 + 1);
+#else
+  values = allocate_array<signed char>(twice + sizeof(int) - 1);
+#endif
+  matrix.segments = allocate_array<Segment>(twice);
+  watched.segments = allocate_array<Segment>(twice);
+  ternary.segments = allocate_array<Segment>(twice);
 
 
-  levels = new unsigned[size];
-  stamped = new size_t[size]();
-  reasons = new Clause *[size];
+  levels = allocate_array<unsigned>(size);
+  marks = allocate_array<unsigned char>(size);
+  reasons = allocate_array<Clause *>(size);
 
   // We subtract 'variables' in order to be able to access
   // the arrays with a negative index (valid in C/C++).
 
-  matrix += variables;
-  watched += variables;
+  matrix.segments += variables;
+  watched.segments += variables;
+  ternary.segments += variables;
+#ifndef PACKED
   values += variables;
+#endif
+
+  propagated = assigned = trail = allocate_array<int>(size);
+
+  // Analyzed variables, learned clauses, decoded clauses and the control
+  // stack never have more entries than variables (plus one).
 
-  propagated = assigned = trail = new int[size];
+  analyzed.reserve(size);
+  learned.reserve(size);
+  control.reserve(size + 1);
+  control.push_back({0, 0, 0});
+  if (compress) decode_buffer.reserve(size);
 
   assert(!level);
 }
 
-static void delete_clause(Clause *c) {
-  debug(c, "delete");
-  delete[] c;
+// With '--compress' learned clauses with at least 'compress_size' literals
+// are stored compressed.  Their literals are mapped to codes '2*(idx-1)'
+// and '2*(idx-1)+1' for negative literals, sorted, and the differences of
+// consecutive codes are stored as variable-length integers of seven bits
+// per byte.  The two watches and the blocker are in the clause header, so
+// visiting such a clause only decodes its literals if a replacement watch
+// has to be searched, as well as if it is used as reason in analysis.
+
+static const unsigned compress_size = 16;
+
+static unsigned literal_code(int lit) {
+  return 2u * (abs(lit) - 1) + (lit < 0);
+}
+
+static int code_literal(unsigned code) {
+  int idx = code / 2 + 1;
+  return code & 1 ? -idx : idx;
+}
+
+// Encode the literals in '[p, e)' into 'encode_buffer', which sorts them.
+
+static void encode(int *p, int *e) {
+  std::sort(p, e, [](int a, int b) { return literal_code(a) < literal_code(b); });
+  encode_buffer.clear();
+  unsigned previous = 0;
+  for (; p != e; p++) {
+    unsigned code = literal_code(*p), delta = code - previous;
+    previous = code;
+    while (delta > 127) {
+      encode_buffer.push_back(128 | (delta & 127));
+      delta >>= 7;
+    }
+    encode_buffer.push_back(delta);
+  }
+}
+
+static unsigned read_delta(const unsigned char *&p) {
+  unsigned delta = 0, shift = 0, byte;
+  do {
+    byte = *p++;
+    delta |= (byte & 127) << shift;
+    shift += 7;
+  } while (byte & 128);
+  return delta;
+}
+
+static int *decode(Clause *c) {
+  decodes++;
+  decoded += c->size;
+  if (decode_buffer.size() < c->size) decode_buffer.resize(c->size);
+  const unsigned char *p = (const unsigned char *)c->literals;
+  int *q = decode_buffer.data();
+  unsigned code = 0;
+  for (unsigned i = 0; i != c->size; i++) {
+    code += read_delta(p);
+    q[i] = code_literal(code);
+  }
+  assert(p - (const unsigned char *)c->literals == c->encoded);
+  return q;
+}
+
+int *Clause::begin() { return encoded ? decode(this) : literals; }
+
+int *Clause::end() {
+  return (encoded ? decode_buffer.data() : literals) + size;
+}
+
+// Compaction overwrites the literals of a moved clause by a forwarding
+// pointer, which needs more bytes than a compressed clause shrunken by
+// simplification might have, so each clause reserves at least that much.
+
+static size_t clause_bytes(size_t payload) {
+  payload = std::max(payload, sizeof(struct Clause *));
+  size_t bytes = sizeof(struct Clause) + payload;
+  const size_t alignment = alignof(struct Clause);
+  return (bytes + alignment - 1) & ~(alignment - 1);
+}
+
+static size_t payload(Clause *c) {
+  return c->encoded ? c->encoded : c->size * sizeof(int);
+}
+
+static void new_arena(size_t bytes) {
+  size_t capacity = arenas.empty() ? 0 : 2 * (arenas.back().end - arenas.back().begin);
+  capacity = std::max(capacity, std::max(bytes, (size_t)1 << 16));
+  char *begin = (char *)map_pages(capacity);
+  if (begin)
+    capacity = (capacity + huge_page_bytes - 1) & ~(huge_page_bytes - 1);
+  else
+    begin = new char[capacity];
+  arenas.push_back({begin, begin, begin + capacity});
+}
+
+static Clause *allocate_clause(size_t payload) {
+  size_t bytes = clause_bytes(payload);
+  if (arenas.empty() || (size_t)(arenas.back().end - arenas.back().top) < bytes)
+    new_arena(bytes);
+  Arena &arena = arenas.back();
+  Clause *res = (Clause *)arena.top;
+  arena.top += bytes;
+  arena_bytes += bytes;
+  return res;
+}
+
+static void delete_arenas(std::vector<Arena> &old) {
+  for (auto &arena : old)
+    if (is_mapped(arena.begin))
+      unmap_pages(arena.begin);
+    else
+      delete[] arena.begin;
+  old.clear();
 }
 
+// Deleted clauses stay in the arena as garbage until the next compaction.
+
+static void delete_clause(Clause *c) { debug(c, "delete"); }
+
 static void release(void) {
-  for (auto c : clauses) delete_clause(c);
+  delete_arenas(arenas);
+
+  size_t size = variables + 1, twice = 2 * size;
 
-  delete[] trail;
+  delete_array(trail, size);
 
-  matrix -= variables;
-  watched -= variables;
+  matrix.segments -= variables;
+  watched.segments -= variables;
+  ternary.segments -= variables;
+#ifndef PACKED
   values -= variables;
+#endif
+
+  delete_array(matrix.segments, twice);
+  delete_array(watched.segments, twice);
+  delete_array(ternary.segments, twice);
 
-  delete[] matrix;
-  delete[] watched;
-  delete[] values;
+  matrix.release();
+  watched.release();
+  ternary.release();
+#ifdef PACKED
+  delete_array(values, size / 4 + 1);
+#else
+  delete_array(values, twice + sizeof(int) - 1);
+#endif
+
+  delete_array(levels, size);
+  delete_array(marks, size);
+  delete_array(reasons, size);
 
-  delete[] levels;
-  delete[] stamped;
+  delete[] internal;
+  delete[] external;
 }
 
 static bool satisfied(Clause *c) {
   for (auto lit : *c)
-    if (values[lit] > 0) return true;
+    if (val(lit) > 0) return true;
   return false;
 }
 
@@ -324,10 +914,9 @@ static bool satisfied() {
 static void assign(int lit, Clause *reason) {
   debug("assign %s", debug(lit));
   assert(lit);
-  assert(!values[lit]);
-  assert(!values[-lit]);
-  values[lit] = 1;
-  values[-lit] = -1;
+  assert(!val(lit));
+  assert(!val(-lit));
+  set_val(lit);
   int idx = abs(lit);
   levels[idx] = level;
   reasons[idx] = reason;
@@ -335,26 +924,60 @@ static void assign(int lit, Clause *reason) {
   if (!level) fixed++;
 }
 
+// Watch the clause by 'watch1' and 'watch2' in the ternary or the generic
+// watch lists.  A compressed clause shrunken to three literals by
+// simplification has to be decoded to find its third literal.
+
+static void watch_clause(Clause *c) {
+  if (c->size == 3) {
+    int third = c->begin()[2];
+    ternary.push_back(c->watch1, {c->watch2, third, c});
+    ternary.push_back(c->watch2, {c->watch1, third, c});
+  } else {
+    watched.push_back(c->watch1, c);
+    watched.push_back(c->watch2, c);
+  }
+}
+
 static void connect_literal(int lit, Clause *c) {
   debug(c, "connecting %s to", debug(lit));
-  matrix[lit].push_back(c);
+  matrix.push_back(lit, c);
 }
 
-static Clause *add_clause(std::vector<int> &literals) {
+static Clause *add_clause(std::vector<int> &literals, bool redundant = false) {
   size_t size = literals.size();
-  size_t bytes = sizeof(struct Clause) + size * sizeof(int);
-  Clause *c = (Clause *)new char[bytes];
+  size_t bytes = size * sizeof(int);
+  bool compressing = compress && redundant && size >= compress_size;
+  if (compressing) {
+    decode_buffer.assign(literals.begin(), literals.end());
+    encode(decode_buffer.data(), decode_buffer.data() + size);
+    bytes = encode_buffer.size();
+    compressed++;
+    uncompressed += size * sizeof(int);
+    saved += size * sizeof(int) - bytes;
+  }
+  Clause *c = allocate_clause(bytes);
 
   assert(size <= UINT_MAX);
-#ifndef NDEBUG
+#if !defined(NDEBUG) || defined(LOGGING)
   c->id = added;
 #endif
   added++;
 
   c->size = size;
 
-  int *q = c->literals;
-  for (auto lit : literals) *q++ = lit;
+  // The clause memory is raw so the member initializers do not apply.
+  c->watch1 = c->watch2 = c->blocker = 0;
+  c->position = 0;
+  c->encoded = 0;
+
+  if (compressing) {
+    memcpy(c->literals, encode_buffer.data(), bytes);
+    c->encoded = bytes;
+  } else {
+    int *q = c->literals;
+    for (auto lit : literals) *q++ = lit;
+  }
 
   debug(c, "new");
 
@@ -371,7 +994,7 @@ static Clause *add_clause(std::vector<int> &literals) {
     empty_clause = c;
   } else if (size == 1) {
     int unit = literals[0];
-    signed char value = values[unit];
+    signed char value = val(unit);
     if (!value)
       assign(unit, 0);
     else if (value < 0) {
@@ -382,17 +1005,16 @@ static Clause *add_clause(std::vector<int> &literals) {
 
   //initialize watches after handling unit clauses, because atleast 2 literals are needed
   if(size > 1){
-    c->watch1 = c->literals[0];
-    c->watch2 = c->literals[1];
+    c->watch1 = literals[0];
+    c->watch2 = literals[1];
   }
-  if(c->watch1 != 0) watched[c->watch1].push_back(c);
-  if(c->watch2 != 0) watched[c->watch2].push_back(c);
+  if (size > 1) watch_clause(c);
 
   // I was really unsure how one would set a meaningful blocking literal as i didn't manage to find any information about that.
   // However, i figured since the blocking literal is the one we examine the most in the clause it would make sense to set it
   // to just the first literal in the clause, because according to Chu et. al. (2008) most clauses aren't examined further then 
   // the first few literals, with 50-90% of their clauses already terminating after examining the first literal. 
-  c->blocker = c->literals[0];
+  if (size) c->blocker = literals[0];
 
   //c->watch1 = c->literals[0];
   //c->watch2 = c->literals[1];
@@ -413,6 +1035,84 @@ static void parse_error(const char *fmt, ...) {
   exit(1);
 }
 
+static int internal_variable(int idx) { return internal ? internal[idx] : idx; }
+static int external_variable(int idx) { return external ? external[idx] : idx; }
+
+// Encoders number variables in the order they create them, and variables
+// occurring together in clauses can end up far apart in the per-variable
+// and per-literal arrays.  Renumbering the variables in Cuthill-McKee order
+// of the variable interaction graph gives neighbours close indices.  This
+// is a breadth-first search started from a variable with fewest
+// occurrences in each component, where the new neighbours of a variable,
+// i.e., the unnumbered variables in its clauses, are numbered by increasing
+// number of occurrences.  Expanding each clause only once keeps this linear
+// in the size of the formula apart from sorting.  The clauses are given
+// as zero terminated sequences of literals in 'formula'.
+
+static double average_span(const std::vector<int> &formula) {
+  size_t spans = 0, clauses = 0;
+  int min = INT_MAX, max = 0;
+  for (auto lit : formula) {
+    if (lit) {
+      int idx = internal_variable(abs(lit));
+      min = std::min(min, idx);
+      max = std::max(max, idx);
+    } else if (max) {
+      spans += max - min;
+      clauses++;
+      min = INT_MAX, max = 0;
+    }
+  }
+  return clauses ? spans / (double)clauses : 0;
+}
+
+static void renumber_variables(const std::vector<int> &formula) {
+  double before = average_span(formula);
+  std::vector<std::vector<unsigned>> occurrences(variables + 1);
+  std::vector<unsigned> starts;
+  for (size_t i = 0; i != formula.size(); i++) {
+    starts.push_back(i);
+    for (; formula[i]; i++)
+      occurrences[abs(formula[i])].push_back(starts.size() - 1);
+  }
+  auto fewer = [&](int a, int b) {
+    return occurrences[a].size() < occurrences[b].size();
+  };
+  std::vector<int> candidates;
+  for (int idx = 1; idx <= variables; idx++) candidates.push_back(idx);
+  std::stable_sort(candidates.begin(), candidates.end(), fewer);
+  std::vector<bool> expanded(starts.size());
+  std::vector<int> order;  // Breadth-first queue and new order.
+  internal = new int[variables + 1]();
+  external = new int[variables + 1];
+  external[0] = 0;
+  for (auto start : candidates) {
+    if (internal[start]) continue;
+    order.push_back(start);
+    internal[start] = order.size();
+    for (size_t head = order.size() - 1; head != order.size(); head++) {
+      size_t numbered = order.size();
+      for (auto clause : occurrences[order[head]]) {
+        if (expanded[clause]) continue;
+        expanded[clause] = true;
+        for (const int *p = &formula[starts[clause]]; *p; p++) {
+          int idx = abs(*p);
+          if (internal[idx]) continue;
+          order.push_back(idx);
+          internal[idx] = order.size();
+        }
+      }
+      std::stable_sort(order.begin() + numbered, order.end(), fewer);
+      for (size_t i = numbered; i != order.size(); i++)
+        internal[order[i]] = i + 1;
+    }
+  }
+  assert(order.size() == (size_t)variables);
+  for (int idx = 1; idx <= variables; idx++) external[internal[idx]] = idx;
+  verbose("renumbering changed average clause span from %.2f to %.2f",
+          before, average_span(formula));
+}
+
 static void parse(void) {
   int ch;
   while ((ch = getc(file)) == 'c') {
@@ -426,14 +1126,20 @@ static void parse(void) {
     parse_error("invalid header");
   message("parsed header 'p cnf %d %d'", variables, clauses);
   initialize();
-  std::vector<int> clause;
+  std::vector<int> clause, formula;
   int lit = 0, parsed = 0;
   size_t literals = 0;
   while (fscanf(file, "%d", &lit) == 1) {
     if (parsed == clauses) parse_error("too many clauses");
     if (lit == INT_MIN || abs(lit) > variables)
       parse_error("invalid literal '%d'", lit);
-    if (lit) {
+    if (renumber) {
+      formula.push_back(lit);
+      if (lit)
+        literals++;
+      else
+        parsed++;
+    } else if (lit) {
       clause.push_back(lit);
       literals++;
     } else {
@@ -445,9 +1151,75 @@ static void parse(void) {
   if (lit) parse_error("terminating zero missing");
   if (parsed != clauses) parse_error("clause missing");
   if (close_file) fclose(file);
+  if (renumber) {
+    renumber_variables(formula);
+    for (auto lit : formula) {
+      if (lit) {
+        int idx = internal[abs(lit)];
+        clause.push_back(lit < 0 ? -idx : idx);
+      } else {
+        add_clause(clause);
+        clause.clear();
+      }
+    }
+  }
   verbose("parsed %zu literals in %d clauses", literals, parsed);
 }
 
+// Find the first literal in '[p, e)' which is neither false nor one of the
+// two watches and return a pointer to it, or 'e' if there is none.  The
+// AVX2 version checks eight literals at once by gathering their values and
+// comparing the literals against the watches, and leaves the remaining
+// literals to the scalar loop.
+
+static int *find_replacement(int *p, int *e, int watch1, int watch2) {
+#ifdef SIMD
+  const __m256i low_byte = _mm256_set1_epi32(0xff);
+  const __m256i first = _mm256_set1_epi32(watch1);
+  const __m256i second = _mm256_set1_epi32(watch2);
+  for (; e - p >= 8; p += 8) {
+    __m256i lits = _mm256_loadu_si256((const __m256i *)p);
+    __m256i gathered = _mm256_i32gather_epi32((const int *)values, lits, 1);
+    __m256i value = _mm256_and_si256(gathered, low_byte);
+    __m256i skip = _mm256_cmpeq_epi32(value, low_byte);  // False.
+    skip = _mm256_or_si256(skip, _mm256_cmpeq_epi32(lits, first));
+    skip = _mm256_or_si256(skip, _mm256_cmpeq_epi32(lits, second));
+    unsigned mask = ~_mm256_movemask_ps(_mm256_castsi256_ps(skip)) & 0xff;
+    if (mask) return p + __builtin_ctz(mask);
+  }
+#endif
+  for (; p != e; p++) {
+    int x = *p;
+    if (x == watch1 || x == watch2) continue;
+    if (val(x) < 0) continue;
+    break;
+  }
+  return p;
+}
+
+// Compressed clauses are searched for a replacement watch by decoding the
+// literals one by one until a non-false unwatched literal is found.  Since
+// the literals are sorted there is no saved position to resume from.
+
+static int find_encoded_replacement(Clause *c) {
+  decodes++;
+  const unsigned char *start = (const unsigned char *)c->literals;
+  const unsigned char *p = start, *e = start + c->encoded;
+  unsigned code = 0;
+  int res = 0;
+  while (p != e) {
+    code += read_delta(p);
+    decoded++;
+    int lit = code_literal(code);
+    if (lit == c->watch1 || lit == c->watch2) continue;
+    if (val(lit) < 0) continue;
+    res = lit;
+    break;
+  }
+  ticks += (sizeof *c + (p - start)) / cache_line_bytes;
+  return res;
+}
+
 // Return 'false' if propagation detects an empty clause otherwise if it
 // completes propagating all literals since the last time it was called
 // without finding an empty clause it returns 'true'.  Beside finding
@@ -459,137 +1231,227 @@ static Clause *propagate(void) {
     propagations++;
     int lit = *propagated++;
     debug("propagating %d", lit);
-    // The procedure visits every clause that contains a watched instance of -l
-    const auto &occurrences = watched[-lit];
-    for (auto c : occurrences) {
-      //assert(levels[c->blocker] <= levels[-lit]);
-      if(values[c->blocker] == 1) continue;
-
-      int check;
-      if (c->watch1 == -lit) check = c->watch2;
-      else check = c->watch1;
-
-      bool found_new_watch = false;
-      if(values[check] == 1) continue;
-      for (auto other : *c) {
-        if(values[other] == 1) c->blocker=other;
-          
-        // Each of these clauses is visited with the intent to find an unwatched literal, x, that is true or free
-        if(!found_new_watch){
-          if(values[other] > -1 && c->watch1 != other && c->watch2 != other){
-            debug("found new watch %d", other);
-
-            found_new_watch = true;
-            // If such an x is found, a new watch structure is added to W(x), and the current watch on -l is removed from W(-l).
-            watched[-lit].erase(std::remove(watched[-lit].begin(), watched[-lit].end(), c), watched[-lit].end()); //This probably causes problems cause vector is changed while still iterating over it
-            watched[other].push_back(c);
-            if(check == c->watch1) c->watch2 = other;
-            if(check == c->watch2) c->watch1 = other;
-        }
-        }
-        // If no such x is found, every unwatched literal in the clause must already be false. In this case, the watch on -l persists
-        // The clause is satisfied, unit, or false, depending on the status of the other watched literal, k (k -> check)
+    // Visit every clause watching '-lit' and either find a replacement
+    // watch, or the clause is satisfied, forcing or conflicting.  Watches
+    // which stay are compacted in place ('j' trails 'i').
+    Clause **watches = watched.begin(-lit);
+    unsigned size = watched.size(-lit), i = 0, j = 0;
+    ticks += 1 + size * sizeof *watches / cache_line_bytes;
+    Clause *conflict = 0;
+    visits += size;
+    while (i != size) {
+#if PREFETCH
+      if (size - i > PREFETCH) __builtin_prefetch(watches[i + PREFETCH]);
+#endif
+      Clause *c = watches[j++] = watches[i++];
+      ticks++;  // Clause header with blocker and watches.
+      if (val(c->blocker) > 0) continue;
+
+      int other = c->watch1 == -lit ? c->watch2 : c->watch1;
+      signed char value = val(other);
+      if (value > 0) {
+        c->blocker = other;
+        continue;
       }
-      if(!found_new_watch){
-        debug("no watch found %d", values[check]);
-
-        // If k is false, the clause is false
-        if(values[check] == -1){
-          conflicts++;
-          debug(c, "conflicting");
-          return c;
+
+      // Each of these clauses is visited with the intent to find an
+      // unwatched literal, x, that is true or free.  The search starts
+      // where the last replacement was found and wraps around, since the
+      // literals before it are likely still false.  This avoids rescanning
+      // the same false prefix of long clauses on every visit.
+      int replacement;
+      if (c->encoded)
+        replacement = find_encoded_replacement(c);
+      else {
+        int *b = c->begin(), *e = c->end(), *s = b + c->position;
+        int *p = find_replacement(s, e, c->watch1, c->watch2);
+        int *last = p;
+        if (p == e) {
+          p = find_replacement(b, s, c->watch1, c->watch2);
+          if (p == s) p = e;
+          last = e;
         }
-        // If k is true, the clause is satisfied
-        // -> already checked above
-        // If k is free, the clause became unit as l became true.
-        else if (values[check] == 0) assign(check, c);
+        replacement = p != e ? *p : 0;
+        if (replacement) c->position = p - b;
+        ticks += ((char *)last - (char *)c) / cache_line_bytes;
+      }
+
+      if (replacement) {
+        // If such an x is found, a new watch is added to W(x), and the
+        // current watch on -l is removed from W(-l).
+        debug(c, "found new watch %s in", debug(replacement));
+        if (c->watch1 == -lit)
+          c->watch1 = replacement;
+        else
+          c->watch2 = replacement;
+        if (val(replacement) > 0) c->blocker = replacement;
+        watched.push_back(replacement, c);
+        watches = watched.begin(-lit);  // The pool might have moved.
+        j--;
+      } else if (value < 0) {
+        // If no such x is found and the other watch k is false too, the
+        // clause is falsified.
+        conflict = c;
+        break;
+      } else {
+        // Otherwise k is free and the clause became unit.
+        debug(c, "forced %s by", debug(other));
+        assign(other, c);
       }
     }
+    while (i != size) watches[j++] = watches[i++];
+    watched.resize(-lit, j);
+    if (conflict) {
+      conflicts++;
+      debug(conflict, "conflicting");
+      return conflict;
+    }
+    // Then ternary clauses watching '-lit' are either satisfied, forcing or
+    // conflicting, which the two other literals inline in the watch tell,
+    // or they have two unassigned literals and the watch moves to the
+    // unwatched one of them.
+    Ternary *watching = ternary.begin(-lit);
+    unsigned count = ternary.size(-lit), k = 0, l = 0;
+    ticks += count * sizeof *watching / cache_line_bytes;
+    visits += count;
+    ternaries += count;
+    while (k != count) {
+      const Ternary t = watching[l++] = watching[k++];
+      signed char u = val(t.other1), v = val(t.other2);
+      if (u > 0 || v > 0) continue;
+      if (u < 0 && v < 0) {
+        conflict = t.clause;
+        break;
+      }
+      if (u < 0) {
+        debug(t.clause, "forced %s by", debug(t.other2));
+        assign(t.other2, t.clause);
+      } else if (v < 0) {
+        debug(t.clause, "forced %s by", debug(t.other1));
+        assign(t.other1, t.clause);
+      } else {
+        Clause *c = t.clause;
+        ticks++;  // Clause header with watches.
+        int other = c->watch1 == -lit ? c->watch2 : c->watch1;
+        int replacement = other == t.other1 ? t.other2 : t.other1;
+        debug(c, "found new watch %s in", debug(replacement));
+        if (c->watch1 == -lit)
+          c->watch1 = replacement;
+        else
+          c->watch2 = replacement;
+        ternary.push_back(replacement, {other, -lit, c});
+        watching = ternary.begin(-lit);  // The pool might have moved.
+        l--;
+      }
+    }
+    while (k != count) watching[l++] = watching[k++];
+    ternary.resize(-lit, l);
+    if (conflict) {
+      conflicts++;
+      debug(conflict, "conflicting");
+      return conflict;
+    }
   }
   return 0;
 }
 
 static bool is_power_of_two(size_t n) { return n && !(n & (n - 1)); }
 
+static void new_level(int decision) {
+  level++;
+  control.push_back({decision, (unsigned)(assigned - trail), 0});
+  assert(control.size() == level + 1);
+}
+
 static int searched = 1;
 
 static void decide(void) {
   decisions++;
-  while (assert(searched <= variables), values[searched]) searched++;
-  level++;
-  debug("decide %d", searched);
-  control.push_back(assigned);
-  stamped[searched] = 0;
-  assign(searched, 0);
+  while (assert(searched <= variables), val(internal_variable(searched)))
+    searched++;
+  int idx = internal_variable(searched);
+  new_level(idx);
+  debug("decide %d", idx);
+  if (record_file) fprintf(record_file, "d %d\n", idx);
+  assign(idx, 0);
   if (is_power_of_two(decisions)) report('d');
 }
 
 static void unassign(int lit) {
   debug("unassign %s", debug(lit));
   assert(lit);
-  assert(values[lit] == 1);
-  assert(values[-lit] == -1);
-  values[lit] = values[-lit] = 0;
-  int tmp = abs(lit);
-  if (tmp < searched) searched = tmp;
+  assert(val(lit) == 1);
+  assert(val(-lit) == -1);
+  reset_val(lit);
 }
 
+// All variables before a decision of 'decide' were assigned on lower levels
+// and only the variables assigned on the levels above 'new_level' become
+// unassigned, so no unassigned variable precedes the decision of the first
+// removed level.  Probing decides on variables after 'searched' anyhow.
+
 static void backtrack(unsigned new_level) {
   assert(new_level < level);
-  int *before = control[new_level];
+  const Level &first = control[new_level + 1];
+  int decision = external_variable(abs(first.decision));
+  if (decision < searched) searched = decision;
+  int *before = trail + first.trail;
   while (assigned != before) unassign(*--assigned);
-  control.resize(new_level);
+  control.resize(new_level + 1);
   propagated = before;
   level = new_level;
 }
 
 static void analyze_literal(int lit, int &current, int &lower) {
   int idx = abs(lit);
-  assert(values[lit]);
+  assert(val(lit));
   unsigned int lvl = levels[idx];
 
   // analyzed or root level decision
-  if (!lvl || stamped[idx] == conflicts) return;
+  if (!lvl || marks[idx]) return;
 
   debug("analyzing literal %s", debug(lit));
-  assert(values[lit] < 0);
+  assert(val(lit) < 0);
 
-  // stamp literal
-  stamped[idx] = conflicts;
+  // mark literal and remember it for clearing the mark
+  marks[idx] = 1;
+  analyzed.push_back(idx);
 
   if (lvl == level)
-    // increment count of stamped literals on current level
+    // increment count of marked literals on current level
     current++;
   else
-    // increment count of stamped literals on lower level
+    // increment count of marked literals on lower level
     lower++;
 }
 
 static void analyze(Clause *c) {
   debug(c, "analyzing conflict %zu", conflicts);
 
-  // the learned clause
-  std::vector<int> learned;
+#ifndef NDEBUG
+  size_t before = allocations;
+#endif
+  learned.clear();
   // the backjump level
   unsigned backjump = 0;
   // trail traversal pointer
   int *copy = assigned - 1;
 
-  // counts stamped on current level
+  // counts marked on current level
   int current = 0;
-  // counts stamped literals on lower level
+  // counts marked literals on lower level
   int lower = 0;
 
   for (auto lit : *c) analyze_literal(lit, current, lower);
 
-  // go over stamped literals on current level
+  // go over marked literals on current level
   // by traversing trail
   // until one is left (the uip)
   while (current > 1) {
     int lit = *copy--;
     unsigned idx = abs(lit);
 
-    if (stamped[idx] == conflicts) {
+    if (marks[idx]) {
       // recurse if reason is non null
       Clause *reason = reasons[idx];
 
@@ -601,18 +1463,18 @@ static void analyze(Clause *c) {
     }
   }
 
-  // skip non stamped literals on current level
-  while (stamped[abs(*copy)] != conflicts) copy--;
+  // skip non marked literals on current level
+  while (!marks[abs(*copy)]) copy--;
 
   // the last one is uip
   int uip = *copy--;
 
-  // go over stamped literals on lower level
+  // go over marked literals on lower level
   while (lower) {
     int lit = *copy--;
     unsigned idx = abs(lit);
 
-    if (stamped[idx] == conflicts) {
+    if (marks[idx]) {
       // add to learned clause
       learned.push_back(-lit);
 
@@ -625,36 +1487,73 @@ static void analyze(Clause *c) {
     }
   }
 
+  // Count the literals of the learned clause per decision level.  The
+  // number of levels hit, plus the current level of the UIP, is the glue of
+  // the learned clause (before minimization).  Minimization uses the counts
+  // to reject reason literals on levels without literals in the learned
+  // clause without searching it.  Root-level literals are never in it.
+  unsigned levels_seen = 1;
+  for (auto lit : learned)
+    if (!control[levels[abs(lit)]].seen++) levels_seen++;
+  glue += levels_seen;
+
   // Simple minimization
-  for (auto lit : learned) {
+  size_t kept = 0;
+  for (size_t i = 0; i != learned.size(); i++) {
+    int lit = learned[i];
     unsigned idx = abs(lit);
     Clause *reason = reasons[idx];
+    bool minimize = false;
     if (reason) {
-      bool minimize = true;
+      minimize = true;
       for (auto other : *reason) {
         if (idx != abs(other)) {
-          if (std::find(learned.begin(), learned.end(), other) ==
-              learned.end()) {
+          if (!control[levels[abs(other)]].seen ||
+              std::find(learned.begin(), learned.end(), other) ==
+                  learned.end()) {
             minimize = false;
             break;
           }
         }
       }
-      if (minimize)
-        learned.erase(std::remove(learned.begin(), learned.end(), lit),
-                      learned.end());
     }
+    if (!minimize) learned[kept++] = lit;
+  }
+  learned.resize(kept);
+
+  // clear the marks of all analyzed variables and the counts of their levels
+  for (auto idx : analyzed) {
+    marks[idx] = 0;
+    control[levels[idx]].seen = 0;
   }
+  analyzed.clear();
 
-  // add the uip to the clause
+  // add the uip to the clause in front and move a literal on the backjump
+  // level (which minimization might have lowered) to the second position,
+  // since the first two literals are watched
   learned.push_back(-uip);
+  std::swap(learned[0], learned.back());
+  backjump = 0;
+  for (size_t i = 1; i < learned.size(); i++) {
+    unsigned lvl = levels[abs(learned[i])];
+    if (lvl <= backjump) continue;
+    std::swap(learned[1], learned[i]);
+    backjump = lvl;
+  }
+
+  if (record_file) {
+    fprintf(record_file, "l %u", backjump);
+    for (auto lit : learned) fprintf(record_file, " %d", lit);
+    fputs(" 0\n", record_file);
+  }
 
   // backjump
   backtrack(backjump);
+  assert(allocations == before);
 
   // add learned clause if it is not unit clause
   if (learned.size() > 1) {
-    Clause *clause = add_clause(learned);
+    Clause *clause = add_clause(learned, true);
     debug(clause, "learned clause");
     assign(-uip, clause);
   } else
@@ -671,6 +1570,236 @@ static const int unknown = 0;         // Unsolved exit code.
 static const int satisfiable = 10;    // Exit code for satisfiable and
 static const int unsatisfiable = 20;  // unsatisfiable formulas.
 
+// Inprocessing interleaves simplification passes with search.  The passes
+// are scheduled from the search loop whenever it is back at the root level
+// (after learning units, since this engine does not restart yet).  Each
+// pass gets a budget measured as a fraction ('effort') of the number of
+// search propagations since it last ran, and is delayed by an interval in
+// conflicts which is doubled whenever the pass turned out ineffective.
+
+struct Pass {
+  const char *name;
+  bool (*run)(size_t budget);  // Returns 'true' if effective.
+  double effort;               // Budget relative to search propagations.
+  size_t interval;             // Initial (and reset) interval in conflicts.
+  size_t delay;                // Current interval in conflicts.
+  size_t next;                 // Conflicts at which the pass is due.
+  size_t last;                 // Search propagations when last run.
+  size_t calls;                // Number of times run.
+  size_t effective;            // Number of effective runs.
+  double time;                 // Process time spent in the pass.
+};
+
+static size_t search_propagations(void) { return propagations - inprocessed; }
+
+// Removing root-level satisfied clauses and root-level falsified literals
+// does not change the fixpoint of unit propagation, but shrinks the clause
+// database and makes the watch lists shorter.  It requires the root level
+// to be completely propagated without conflict and is only effective if
+// new units have been found since it last ran.  Its cost is linear in the
+// size of the clause database and thus the budget is not needed.
+
+static int simplified;  // Fixed variables during last simplification.
+
+// Copy the watched clauses into a fresh arena in watch list order and
+// update the watches, and then the stack of clauses, to the copies.  A
+// copied clause is marked by a zero 'watch1' and the first two literals of
+// the original are overwritten by a forwarding pointer to the copy.  This
+// requires all clauses to be watched and no reasons to point to clauses,
+// which holds after simplification at the root level.
+
+static Clause *move_clause(Clause *c) {
+  Clause *res;
+  if (!c->watch1) {
+    memcpy(&res, c->literals, sizeof res);
+    return res;
+  }
+  assert(c->size > 1);
+  res = allocate_clause(payload(c));
+  memcpy((void *)res, (void *)c, sizeof(struct Clause) + payload(c));
+  c->watch1 = 0;
+  memcpy(c->literals, &res, sizeof res);
+  return res;
+}
+
+static void compact_lists(void) {
+  size_t garbage = matrix.garbage + watched.garbage + ternary.garbage;
+  matrix.compact(variables);
+  watched.compact(variables);
+  ternary.compact(variables);
+  verbose("compacted lists removing %zu garbage entries", garbage);
+}
+
+static void compact_arena(void) {
+  size_t live = 0;
+  for (auto c : clauses) live += clause_bytes(payload(c));
+  double before = percent(arena_bytes - live, arena_bytes);
+  std::vector<Arena> old;
+  old.swap(arenas);
+  size_t old_bytes = arena_bytes;
+  arena_bytes = 0;
+  new_arena(2 * live);
+  for (int lit = -variables; lit <= variables; lit++) {
+    for (Clause **p = watched.begin(lit), **e = watched.end(lit); p != e; p++)
+      *p = move_clause(*p);
+    for (Ternary *p = ternary.begin(lit), *e = ternary.end(lit); p != e; p++)
+      p->clause = move_clause(p->clause);
+  }
+  for (auto &c : clauses) c = move_clause(c);
+  delete_arenas(old);
+  double after = percent(arena_bytes - live, arena_bytes);
+  compactions++;
+  fragmented += before;
+  defragmented += after;
+  verbose("compacted arena from %zu to %zu bytes "
+          "(%.2f%% to %.2f%% garbage)",
+          old_bytes, arena_bytes, before, after);
+}
+
+static bool simplify(size_t) {
+  assert(!level);
+  assert(propagated == assigned);
+  if (fixed == simplified) return false;
+  simplified = fixed;
+
+  for (int *p = trail; p != assigned; p++) reasons[abs(*p)] = 0;
+
+  size_t before_collected = collected, before_shrunken = shrunken;
+  auto q = clauses.begin();
+  for (auto c : clauses) {
+    if (satisfied(c)) {
+      delete_clause(c);
+      collected++;
+      continue;
+    }
+    int *b = c->begin(), *e = c->end(), *r = b;
+    for (int *p = b; p != e; p++)
+      if (val(*p) < 0)
+        shrunken++;
+      else
+        *r++ = *p;
+    c->size = r - b;
+    assert(c->size > 1);
+    if (c->encoded) {
+      // Shrinking never makes the encoding longer, since the code
+      // difference spanning a removed literal does not need more bytes
+      // than the two differences it replaces.
+      encode(b, r);
+      assert(encode_buffer.size() <= c->encoded);
+      c->encoded = encode_buffer.size();
+      memcpy(c->literals, encode_buffer.data(), c->encoded);
+    }
+    c->watch1 = b[0];
+    c->watch2 = b[1];
+    c->blocker = b[0];
+    c->position = 0;
+    *q++ = c;
+  }
+  clauses.resize(q - clauses.begin());
+
+  for (int lit = -variables; lit <= variables; lit++) {
+    matrix.clear(lit);
+    watched.clear(lit);
+    ternary.clear(lit);
+  }
+  for (auto c : clauses) watch_clause(c);
+  compact_arena();
+  for (auto c : clauses)
+    for (auto lit : *c) matrix.push_back(lit, c);
+  compact_lists();
+
+  verbose("simplification removed %zu clauses and %zu literals",
+          collected - before_collected, shrunken - before_shrunken);
+  return collected > before_collected || shrunken > before_shrunken;
+}
+
+// Failed literal probing assigns both phases of unassigned variables on
+// decision level one in a round-robin fashion until the propagation budget
+// is used up.  If propagating a literal yields a conflict its negation is
+// a unit, which is assigned and propagated at the root level right away.
+
+static int probed;  // Last probed variable.
+
+static bool probe(size_t budget) {
+  assert(!level);
+  assert(propagated == assigned);
+  size_t before = propagations, found = failed;
+  for (int count = 0; count < variables; count++) {
+    if (propagations - before >= budget) break;
+    if (++probed > variables) probed = 1;
+    if (val(probed)) continue;
+    for (int lit = probed; lit; lit = lit > 0 ? -lit : 0) {
+      new_level(lit);
+      assign(lit, 0);
+      Clause *conflict = propagate();
+      backtrack(0);
+      if (!conflict) continue;
+      conflicts--;  // Not a search conflict.
+      failed++;
+      debug("failed literal %d", lit);
+      if (record_file) fprintf(record_file, "u %d\n", -lit);
+      assign(-lit, 0);
+      if ((conflict = propagate())) {
+        debug(conflict, "root-level conflicting");
+        empty_clause = conflict;  // Resolves to the empty clause.
+        inprocessed += propagations - before;
+        return true;
+      }
+      break;
+    }
+  }
+  inprocessed += propagations - before;
+  verbose("probing found %zu failed literals", failed - found);
+  return failed > found;
+}
+
+static Pass passes[] = {
+    {"simplify", simplify, 1.0, 100, 100, 100, 0, 0, 0, 0},
+    {"probe", probe, 0.1, 1000, 1000, 1000, 0, 0, 0, 0},
+};
+
+static const size_t minimum_budget = 1000;
+
+// Run all passes which are due.  Returns 'true' if a pass ran, since it
+// might have derived the empty clause or assigned units, which are not
+// necessarily propagated yet and might even complete the assignment.  The
+// search loop then has to start over instead of deciding.
+
+static bool inprocess(void) {
+  assert(!level);
+  if (!inprocessing) return false;
+  bool ran = false;
+  for (auto &pass : passes) {
+    if (conflicts < pass.next) continue;
+    ran = true;
+    size_t search = search_propagations();
+    size_t budget = pass.effort * (search - pass.last);
+    if (budget < minimum_budget) budget = minimum_budget;
+    double start = process_time();
+    bool effective = pass.run(budget);
+    pass.time += process_time() - start;
+    pass.calls++;
+    if (effective) {
+      pass.effective++;
+      pass.delay = pass.interval;
+    } else
+      pass.delay *= 2;
+    pass.next = conflicts + pass.delay;
+    pass.last = search;
+    if (empty_clause) break;
+  }
+  return ran;
+}
+
+// Checking the process time is comparably expensive, so we only do it once
+// every 1024 calls (for instance decisions).
+
+static bool out_of_time(void) {
+  static unsigned calls;
+  if (!time_limit || ++calls & 1023) return false;
+  return process_time() >= time_limit;
+}
+
 static int solve(void) {
   if (empty_clause) return unsatisfiable;
   for (;;) {
@@ -680,13 +1809,127 @@ static int solve(void) {
       analyze(conflict);
     } else if (satisfied())
       return satisfiable;
-    else if (conflicts >= limit)
+    else if (conflicts >= limit || ticks >= tick_limit || out_of_time())
       return unknown;
-    else
+    else if (!level && inprocess()) {
+      if (empty_clause) return unsatisfiable;
+    } else
       decide();
   }
 }
 
+// Replaying a trace recorded with '--record' performs exactly the same
+// decisions, backtracks and learned clause additions as the recorded run,
+// but without decision heuristics and conflict analysis.  Since unit
+// propagation reaches the same fixpoint (or a conflict) independent of
+// the order of propagating literals, any variant of the propagation data
+// structures compiled from this file can replay the same trace.  Only
+// the time spent in 'propagate' and 'backtrack' is measured.
+
+static Clause *replay_propagate(void) {
+  double start = wall_clock_time();
+  Clause *conflict = propagate();
+  propagate_time += wall_clock_time() - start;
+  return conflict;
+}
+
+static void replay_backtrack(unsigned new_level) {
+  double start = wall_clock_time();
+  backtrack(new_level);
+  backtrack_time += wall_clock_time() - start;
+  backtracks++;
+}
+
+static void trace_error(const char *path, size_t event, const char *what) {
+  die("replaying event %zu of '%s' failed: %s", event, path, what);
+}
+
+static int replay(void) {
+  FILE *trace = fopen(replay_path, "r");
+  if (!trace) die("could not open and read '%s'", replay_path);
+
+  // Read the whole trace first to keep file parsing out of the timing.
+  // Decisions are stored as '0 <lit>', learned clauses as
+  // '1 <backjump> <size> <literals> ...' and root-level units found
+  // during inprocessing as '2 <lit>'.
+
+  std::vector<int> events;
+  size_t parsed = 0;
+  int ch;
+  while ((ch = getc(trace)) != EOF) {
+    if (ch == '\n') continue;
+    int lit;
+    unsigned jump;
+    if (ch == 'd' && fscanf(trace, "%d", &lit) == 1 && lit &&
+        abs(lit) <= variables) {
+      events.push_back(0);
+      events.push_back(lit);
+    } else if (ch == 'u' && fscanf(trace, "%d", &lit) == 1 && lit &&
+               abs(lit) <= variables) {
+      events.push_back(2);
+      events.push_back(lit);
+    } else if (ch == 'l' && fscanf(trace, "%u", &jump) == 1) {
+      events.push_back(1);
+      events.push_back(jump);
+      size_t size_position = events.size();
+      events.push_back(0);
+      while (fscanf(trace, "%d", &lit) == 1 && lit) {
+        if (abs(lit) > variables) trace_error(replay_path, parsed, "invalid literal");
+        events.push_back(lit);
+        events[size_position]++;
+      }
+      if (lit || !events[size_position])
+        trace_error(replay_path, parsed, "invalid learned clause");
+    } else
+      trace_error(replay_path, parsed, "invalid event");
+    parsed++;
+  }
+  fclose(trace);
+  message("replaying %zu events from '%s'", parsed, replay_path);
+
+  if (empty_clause) return unsatisfiable;
+
+  std::vector<int> literals;
+  Clause *conflict = replay_propagate();
+  size_t event = 0;
+  for (auto p = events.begin(); p != events.end(); event++) {
+    int type = *p++;
+    if (type == 0) {
+      int lit = *p++;
+      if (conflict) trace_error(replay_path, event, "unexpected conflict");
+      if (val(lit)) trace_error(replay_path, event, "decision assigned");
+      decisions++;
+      new_level(lit);
+      assign(lit, 0);
+    } else if (type == 2) {
+      int lit = *p++;
+      if (conflict) trace_error(replay_path, event, "unexpected conflict");
+      if (level) trace_error(replay_path, event, "unit above root level");
+      if (val(lit)) trace_error(replay_path, event, "unit assigned");
+      assign(lit, 0);
+    } else {
+      unsigned jump = *p++;
+      int size = *p++;
+      if (!conflict) trace_error(replay_path, event, "conflict missing");
+      if (jump >= level) trace_error(replay_path, event, "invalid backjump");
+      replay_backtrack(jump);
+      literals.assign(p, p + size);
+      p += size;
+      if (val(literals[0]))
+        trace_error(replay_path, event, "learned literal assigned");
+      if (size > 1)
+        assign(literals[0], add_clause(literals, true));
+      else
+        assign(literals[0], 0);
+    }
+    conflict = replay_propagate();
+  }
+
+  if (conflict && !level) return unsatisfiable;
+  if (!conflict && satisfied()) return satisfiable;
+  return unknown;
+}
+
 // Checking the model on the original formula is extremely useful for
 // testing and debugging.  This 'checker' aborts if an unsatisfied clause is
 // found and prints the clause on '<stderr>' for debugging purposes.
@@ -708,20 +1951,18 @@ static void check_model(void) {
 //
 //   v -1 2 3 0
 //
-// Always prints a full assignments even if not all values are set.
+// Always prints a full assignments even if not all values are set.  The
+// model is printed in terms of the external variables.
 
 static void print_model(void) {
   printf("v ");
   for (int idx = 1; idx <= variables; idx++) {
-    if (values[idx] < 0) printf("-");
+    if (val(internal_variable(idx)) < 0) printf("-");
     printf("%d ", idx);
   }
   printf("0\n");
 }
 
-static double average(double a, double b) { return b ? a / b : 0; }
-static double percent(double a, double b) { return average(100 * a, b); }
-
 // The main function expects at most one argument which is then considered
 // as the path to a DIMACS file. Without argument the solver reads from
 // '<stdin>' (the standard input connected for instance to the terminal).
@@ -736,9 +1977,64 @@ static void print_statistics() {
          average(decisions, t));
   printf("c %-15s %16zu %12.2f %% conflicts\n", "backjumps:", backjumps,
          percent(backjumps, conflicts));
+  printf("c %-15s %16zu %12.2f per learned clause\n", "glue:", glue,
+         average(glue, conflicts));
   printf("c %-15s %16zu %12.2f million per second\n",
          "propagations:", propagations, average(propagations * 1e-6, t));
+  printf("c %-15s %16zu %12.2f per propagation\n", "ticks:", ticks,
+         average(ticks, propagations));
+  printf("c %-15s %16zu %12.2f %% visited watches\n", "ternary:", ternaries,
+         percent(ternaries, visits));
+#ifndef NDEBUG
+  printf("c %-15s %16zu %12.2f per conflict\n", "allocations:",
+         search_allocations, average(search_allocations, conflicts));
+#endif
+  size_t misses;
+  if (read_dtlb_counter(misses))
+    printf("c %-15s %16zu %12.2f per propagation\n", "dtlb-misses:", misses,
+           average(misses, propagations));
+  if (huge_pages)
+    printf("c %-15s %16zu %12.2f MB\n", "huge-pages:", maps,
+           mapped / (double)(1 << 20));
   printf("c\n");
+  if (inprocessing && !replay_path) {
+    for (auto &pass : passes) {
+      char name[32];
+      snprintf(name, sizeof name, "%s:", pass.name);
+      printf("c %-15s %16zu %12.2f %% effective %8.2f seconds\n", name,
+             pass.calls, percent(pass.effective, pass.calls), pass.time);
+    }
+    printf("c %-15s %16zu %12.2f %% propagations\n",
+           "inprocessed:", inprocessed, percent(inprocessed, propagations));
+    printf("c %-15s %16zu %12.2f per simplification\n", "collected:",
+           collected, average(collected, passes[0].calls));
+    printf("c %-15s %16zu %12.2f per simplification\n", "shrunken:",
+           shrunken, average(shrunken, passes[0].calls));
+    printf("c %-15s %16zu %12.2f per probing\n", "failed:", failed,
+           average(failed, passes[1].calls));
+    printf("c %-15s %16zu %12.2f %% garbage before %6.2f %% after\n",
+           "compactions:", compactions, average(fragmented, compactions),
+           average(defragmented, compactions));
+    printf("c\n");
+  }
+  if (compress) {
+    printf("c %-15s %16zu %12.2f %% bytes saved\n", "compressed:",
+           compressed, percent(saved, uncompressed));
+    printf("c %-15s %16zu %12.2f literals per decode\n", "decodes:",
+           decodes, average(decoded, decodes));
+    printf("c\n");
+  }
+  if (replay_path) {
+    double replayed = propagate_time + backtrack_time;
+    printf("c %-15s %16zu %12.2f per second\n", "backtracks:", backtracks,
+           average(backtracks, backtrack_time));
+    printf("c %-15s %16.4f seconds %8.2f million propagations per second\n",
+           "propagate-time:", propagate_time,
+           average(propagations * 1e-6, propagate_time));
+    printf("c %-15s %16.4f seconds\n", "backtrack-time:", backtrack_time);
+    printf("c %-15s %16.4f seconds\n", "replay-time:", replayed);
+    printf("c\n");
+  }
   printf("c %-15s %16.2f seconds\n", "process-time:", t);
   printf("c\n");
 }
@@ -796,9 +2092,36 @@ int main(int argc, char **argv) {
       verbosity = 1;
     else if (!strcmp(arg, "-n") || !strcmp(arg, "--no-witness"))
       witness = false;
+    else if (!strcmp(arg, "--no-inprocessing"))
+      inprocessing = false;
+    else if (!strcmp(arg, "--inprocess-interval")) {
+      if (++i == argc) die("argument to '--inprocess-interval' missing");
+      size_t interval = atol(argv[i]);
+      for (auto &pass : passes) {
+        pass.next = interval;  // With zero the passes are due right away.
+        pass.interval = pass.delay = std::max(interval, (size_t)1);
+      }
+    }    else if (!strcmp(arg, "--renumber"))
+      renumber = true;
+    else if (!strcmp(arg, "--compress"))
+      compress = true;
+    else if (!strcmp(arg, "--huge-pages"))
+      huge_pages = true;
     else if (!strcmp(arg, "-c")) {
       if (++i == argc) die("argument to '-c' missing");
       limit = atol(argv[i]);
+    } else if (!strcmp(arg, "--tick-limit")) {
+      if (++i == argc) die("argument to '--tick-limit' missing");
+      tick_limit = atol(argv[i]);
+    } else if (!strcmp(arg, "--time-limit")) {
+      if (++i == argc) die("argument to '--time-limit' missing");
+      time_limit = atof(argv[i]);
+    } else if (!strcmp(arg, "--record")) {
+      if (++i == argc) die("argument to '--record' missing");
+      record_path = argv[i];
+    } else if (!strcmp(arg, "--replay")) {
+      if (++i == argc) die("argument to '--replay' missing");
+      replay_path = argv[i];
     } else if (arg[0] == '-')
       die("invalid option '%s' (try '-h')", arg);
     else if (file_name)
@@ -821,20 +2144,49 @@ int main(int argc, char **argv) {
   message("Copyright (c) 2022-2023, Marek Schuster");
   message("Version %s %s", VERSION, GITID);
   message("Compiled with '%s'", BUILD);
+#ifdef SIMD
+  message("AVX2 replacement watch search");
+#endif
+#ifdef PACKED
+  message("packed assignment values (2 bits per variable)");
+#endif
   line();
   message("reading from '%s'", file_name);
 
   set_signal_handlers();
+  open_dtlb_counter();
+  if (dtlb_counter < 0) verbose("no data TLB miss counter available");
 
   parse();
 
-  verbose("solving with conflict limit %zu", limit);
-
-  report('*');
-  int res = solve();
-  report(res == 10 ? '1' : res == 20 ? '0' : '?');
+  if (record_path && replay_path) die("can not record and replay together");
+  if (record_path && !(record_file = fopen(record_path, "w")))
+    die("could not open and write '%s'", record_path);
+
+  int res;
+  if (replay_path)
+    res = replay();
+  else {
+    verbose("solving with conflict limit %zu", limit);
+    verbose("solving with tick limit %zu", tick_limit);
+    if (time_limit) verbose("solving with time limit %.2f seconds", time_limit);
+    report('*');
+#ifndef NDEBUG
+    size_t before = allocations;
+#endif
+    res = solve();
+#ifndef NDEBUG
+    search_allocations = allocations - before;
+#endif
+    report(res == 10 ? '1' : res == 20 ? '0' : '?');
+  }
   line();
 
+  if (record_file) {
+    fclose(record_file);
+    message("recorded decisions and learned clauses to '%s'", record_path);
+  }
+
   if (res == 10) {
     check_model();
     printf("s SATISFIABLE\n");
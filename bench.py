@@ -0,0 +1,346 @@
+#!/usr/bin/env python3
+"""
+Benchmark Harness
+
+Run one or more solver binaries over a list of CNF files in DIMACS format,
+with a timeout and repetitions per instance, and record wall time, process
+time, conflicts, decisions, propagations, propagation ticks and data TLB
+misses (if the solver reports them) plus rates to a CSV file.
+
+The results can be saved as baseline and later runs are compared against
+it.  A run whose process time exceeds the baseline by more than the given
+threshold (and by more than the noise floor in absolute terms), or whose
+status differs from the baseline, counts as regression and makes the
+harness exit with a non-zero exit code.
+
+With '--replay' the first solver records the decisions and learned clauses
+of a run on each instance to 'bench/traces/<instance>.trace', which all
+solvers then replay.  Replaying only measures the time spent in propagation
+and backtracking, which is used instead of the process time.
+
+Examples:
+
+  ./bench.py --engine watches --save-baseline
+  ./bench.py --engine watches --repeat 5 --threshold 5
+  ./bench.py --solver ./babysat-watches --label watches-prefetch
+  ./bench.py --engine dpll --engine backtrack --list cnfs/small.list
+  ./bench.py --engine watches --args "--tick-limit 100000000" --timeout 0
+  ./bench.py --engine watches --solver ./babysat-variant --replay
+"""
+
+import argparse
+import csv
+import glob
+import os
+import re
+import resource
+import statistics
+import subprocess
+import sys
+import time
+
+
+FIELDS = [
+    "solver",
+    "instance",
+    "status",
+    "repeat",
+    "wall",
+    "process",
+    "conflicts",
+    "decisions",
+    "propagations",
+    "ticks",
+    "dtlb_misses",
+    "conflicts_per_second",
+    "propagations_per_second",
+]
+
+STATUS = {10: "sat", 20: "unsat", 0: "unknown"}
+
+STATISTIC = re.compile(r"^c ([a-z-]+):\s+(\d+(?:\.\d+)?)")
+
+
+def read_list(path):
+    """
+    Read a benchmark list with one CNF path per line.  Empty lines and
+    lines starting with '#' are skipped and relative paths are interpreted
+    relative to the directory of the list.
+    """
+    base = os.path.dirname(path)
+    instances = []
+    with open(path, "r", encoding="utf-8") as file:
+        for line in file:
+            line = line.strip()
+            if not line or line.startswith("#"):
+                continue
+            instances.append(os.path.join(base, line))
+    return instances
+
+
+def parse_statistics(output):
+    """
+    Extract the statistics lines 'c <name>: <value> ...' printed by the
+    solvers at the end of a run into a dictionary.
+    """
+    stats = {}
+    for line in output.splitlines():
+        match = STATISTIC.match(line)
+        if match:
+            stats[match.group(1)] = float(match.group(2))
+    return stats
+
+
+def children_time():
+    """
+    Return the accumulated user and system time of terminated children.
+    """
+    usage = resource.getrusage(resource.RUSAGE_CHILDREN)
+    return usage.ru_utime + usage.ru_stime
+
+
+def run_once(solver, args, instance, timeout):
+    """
+    Run the solver once on the instance and return status, wall time,
+    process time and the parsed statistics.
+    """
+    command = [solver, "-n"] + args + [instance]
+    before = children_time()
+    start = time.monotonic()
+    process = subprocess.Popen(
+        command, stdout=subprocess.PIPE, stderr=subprocess.DEVNULL, text=True
+    )
+    try:
+        output, _ = process.communicate(timeout=timeout or None)
+        status = STATUS.get(process.returncode, "error")
+    except subprocess.TimeoutExpired:
+        process.kill()
+        output, _ = process.communicate()
+        status = "timeout"
+    wall = time.monotonic() - start
+    return status, wall, children_time() - before, parse_statistics(output)
+
+
+def record(solver, args, instance, timeout):
+    """
+    Record a trace of the solver run on the instance for replaying and
+    return the path to the trace.
+    """
+    name = os.path.splitext(os.path.basename(instance))[0]
+    path = os.path.join("bench", "traces", f"{name}.trace")
+    os.makedirs(os.path.dirname(path), exist_ok=True)
+    run_once(solver, args + ["--record", path], instance, timeout)
+    return path
+
+
+def run(solver, label, args, instance, timeout, repeat, replayed=False):
+    """
+    Run the solver 'repeat' times on the instance and return a result row
+    with the median times.  The search statistics are deterministic and
+    taken from the last run.  Repetitions stop early after a timeout.  When
+    replaying the time spent in propagation and backtracking reported by
+    the solver replaces the process time.
+    """
+    walls, processes = [], []
+    for _ in range(repeat):
+        status, wall, process, stats = run_once(solver, args, instance, timeout)
+        if replayed:
+            process = stats.get("replay-time", 0)
+        walls.append(wall)
+        processes.append(process)
+        if status == "timeout":
+            break
+    process = statistics.median(processes)
+    conflicts = int(stats.get("conflicts", 0))
+    decisions = int(stats.get("decisions", 0))
+    propagations = int(stats.get("propagations", 0))
+    ticks = int(stats.get("ticks", 0))
+    dtlb_misses = int(stats.get("dtlb-misses", 0))
+    return {
+        "solver": label,
+        "instance": os.path.basename(instance),
+        "status": status,
+        "repeat": len(processes),
+        "wall": f"{statistics.median(walls):.3f}",
+        "process": f"{process:.3f}",
+        "conflicts": conflicts,
+        "decisions": decisions,
+        "propagations": propagations,
+        "ticks": ticks,
+        "dtlb_misses": dtlb_misses,
+        "conflicts_per_second": f"{conflicts / process if process else 0:.0f}",
+        "propagations_per_second": f"{propagations / process if process else 0:.0f}",
+    }
+
+
+def write_csv(path, rows):
+    """
+    Write the result rows to a CSV file.
+    """
+    os.makedirs(os.path.dirname(path) or ".", exist_ok=True)
+    with open(path, "w", encoding="utf-8", newline="") as file:
+        writer = csv.DictWriter(file, fieldnames=FIELDS)
+        writer.writeheader()
+        writer.writerows(rows)
+
+
+def read_csv(path):
+    """
+    Read result rows from a CSV file indexed by solver label and instance.
+    """
+    with open(path, "r", encoding="utf-8", newline="") as file:
+        return {(row["solver"], row["instance"]): row for row in csv.DictReader(file)}
+
+
+def compare(rows, baseline, threshold, floor):
+    """
+    Compare the result rows against the baseline and return the number of
+    regressions.  Prints one line per instance with the process time ratio.
+    """
+    regressions = 0
+    total, total_baseline = 0.0, 0.0
+    print(f"{'instance':<24} {'baseline':>9} {'current':>9} {'ratio':>7}")
+    for row in rows:
+        old = baseline.get((row["solver"], row["instance"]))
+        if not old:
+            print(f"{row['instance']:<24} {'-':>9} {row['process']:>9}")
+            continue
+        current, previous = float(row["process"]), float(old["process"])
+        total += current
+        total_baseline += previous
+        ratio = current / previous if previous else 1.0
+        verdict = ""
+        if row["status"] != old["status"]:
+            verdict = f"STATUS {old['status']} -> {row['status']}"
+        elif current > previous * (1 + threshold / 100) and current - previous > floor:
+            verdict = "REGRESSION"
+        if verdict:
+            regressions += 1
+        misses, previous_misses = int(row["dtlb_misses"]), int(old.get("dtlb_misses") or 0)
+        if misses and previous_misses:
+            verdict = f"{verdict} dTLB misses {misses / previous_misses:.2f}".strip()
+        print(
+            f"{row['instance']:<24} {previous:>9.3f} {current:>9.3f} {ratio:>7.2f} {verdict}"
+        )
+    ratio = total / total_baseline if total_baseline else 1.0
+    print(f"{'total':<24} {total_baseline:>9.3f} {total:>9.3f} {ratio:>7.2f}")
+    return regressions
+
+
+def main():
+    """
+    Parse command line options, run the benchmarks and compare results.
+    """
+    parser = argparse.ArgumentParser(
+        description="Benchmark solver engines over a list of CNF files",
+        formatter_class=argparse.RawDescriptionHelpFormatter,
+        epilog=__doc__,
+    )
+    parser.add_argument(
+        "--engine", action="append", default=[], help="engine name (runs './babysat-<engine>')"
+    )
+    parser.add_argument(
+        "--solver", action="append", default=[], help="path to a solver binary"
+    )
+    parser.add_argument("--label", type=str, help="label for results (single solver)")
+    parser.add_argument(
+        "--args", type=str, default="", help="additional solver arguments"
+    )
+    parser.add_argument(
+        "--list", type=str, help="benchmark list file (default all 'cnfs/*.cnf')"
+    )
+    parser.add_argument(
+        "--timeout", type=float, default=60, help="timeout in seconds (default 60, 0 for none)"
+    )
+    parser.add_argument(
+        "--repeat", type=int, default=3, help="repetitions per instance (default 3)"
+    )
+    parser.add_argument("--csv", type=str, help="output CSV (default 'bench/<label>.csv')")
+    parser.add_argument(
+        "--baseline", type=str, help="baseline CSV (default 'bench/<label>-baseline.csv')"
+    )
+    parser.add_argument(
+        "--replay",
+        action="store_true",
+        help="record traces with the first solver and replay them",
+    )
+    parser.add_argument(
+        "--save-baseline", action="store_true", help="store results as new baseline"
+    )
+    parser.add_argument(
+        "--threshold",
+        type=float,
+        default=10,
+        help="regression threshold in percent of process time (default 10)",
+    )
+    parser.add_argument(
+        "--floor",
+        type=float,
+        default=0.05,
+        help="ignore differences below this many seconds (default 0.05)",
+    )
+
+    args = parser.parse_args()
+
+    solvers = [(f"./babysat-{engine}", engine) for engine in args.engine]
+    solvers += [(path, os.path.basename(path)) for path in args.solver]
+    if not solvers:
+        solvers = [("./babysat-watches", "watches")]
+    if args.label:
+        if len(solvers) != 1:
+            parser.error("'--label' requires exactly one solver")
+        solvers = [(solvers[0][0], args.label)]
+
+    if args.list:
+        instances = read_list(args.list)
+    else:
+        instances = sorted(glob.glob("cnfs/*.cnf"))
+
+    name = "-".join(label for _, label in solvers)
+    if args.replay:
+        name += "-replay"
+    csv_path = args.csv or os.path.join("bench", f"{name}.csv")
+    baseline_path = args.baseline or os.path.join("bench", f"{name}-baseline.csv")
+
+    rows = []
+    traces = {}
+    for solver, label in solvers:
+        if not os.access(solver, os.X_OK):
+            sys.exit(f"bench.py: error: can not execute '{solver}'")
+        for instance in instances:
+            extra = args.args.split()
+            if args.replay:
+                trace = traces.get(instance)
+                if not trace:
+                    trace = record(solver, extra, instance, args.timeout)
+                    traces[instance] = trace
+                extra = extra + ["--replay", trace]
+            row = run(solver, label, extra, instance, args.timeout, args.repeat, args.replay)
+            misses = f" {row['dtlb_misses']} dTLB misses" if row["dtlb_misses"] else ""
+            print(
+                f"{label} {row['instance']} {row['status']} {row['process']}s "
+                f"{row['conflicts_per_second']} conflicts/s "
+                f"{row['propagations_per_second']} propagations/s{misses}",
+                flush=True,
+            )
+            rows.append(row)
+
+    write_csv(csv_path, rows)
+    print(f"bench.py: wrote '{csv_path}'")
+
+    if args.save_baseline:
+        write_csv(baseline_path, rows)
+        print(f"bench.py: saved baseline '{baseline_path}'")
+        return 0
+
+    if not os.path.exists(baseline_path):
+        print(f"bench.py: no baseline '{baseline_path}' (use '--save-baseline')")
+        return 0
+
+    regressions = compare(rows, read_csv(baseline_path), args.threshold, args.floor)
+    print(f"bench.py: {regressions} regressions against '{baseline_path}'")
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,342 @@
+#!/usr/bin/env python3
+"""
+CNF Generator
+
+Generate scalable benchmark instances in DIMACS format on '<stdout>' for
+the two families shipped in 'cnfs/'.  Circuits are built from two-input
+AND gates with constant folding and structural hashing, and each gate is
+encoded with the usual three Tseitin clauses, as in 'cnfs/add*.cnf' and
+'cnfs/prime*.cnf'.
+
+adder [--kogge-stone] <bits>
+
+  Miter checking two ripple-carry adders with differently formulated full
+  adders on two '<bits>' wide inputs against each other, like the shipped
+  'cnfs/add*.cnf'.  With '--kogge-stone' the second adder is a Kogge-Stone
+  parallel prefix adder instead, which gives much harder instances.  The
+  formula is always unsatisfiable.
+
+factor <number> | factor --prime <bits> | factor --semiprime <bits>
+
+  Multiplier circuit for two factors, each excluding one, whose product
+  is '<number>'.  The factors have one bit less than '<number>' (unless
+  '--width' is given), which is enough for any non-trivial factor.  Thus
+  the formula is satisfiable if and only if '<number>' is composite.  With
+  '--prime' or '--semiprime' a random prime with '<bits>' bits or a
+  product with '<bits>' bits of two random primes with about half as many
+  bits each is generated ('--seed' makes this reproducible).
+
+Examples:
+
+  ./cnfgen.py adder 256 > add256.cnf
+  ./cnfgen.py adder --kogge-stone 12 > kogge12.cnf
+  ./cnfgen.py factor 4294967297 > fermat5.cnf
+  ./cnfgen.py factor --semiprime 40 --seed 1 > semiprime40.cnf
+  ./cnfgen.py factor --prime 32 --seed 2 > prime32.cnf
+"""
+
+import argparse
+import random
+import sys
+
+
+class Circuit:
+    """
+    And-inverter graph with literals as signed integers, where '-x' is the
+    negation of 'x', and the constants 'TRUE' and 'FALSE'.
+    """
+
+    TRUE = sys.maxsize
+    FALSE = -sys.maxsize
+
+    def __init__(self):
+        self.variables = 0
+        self.gates = []
+        self.table = {}
+        self.units = []
+
+    def input(self):
+        """
+        Return a new input literal.
+        """
+        self.variables += 1
+        return self.variables
+
+    def and_(self, a, b):
+        """
+        Return the conjunction of 'a' and 'b'.
+        """
+        if a == self.FALSE or b == self.FALSE or a == -b:
+            return self.FALSE
+        if a == self.TRUE or a == b:
+            return b
+        if b == self.TRUE:
+            return a
+        key = (min(a, b), max(a, b))
+        gate = self.table.get(key)
+        if not gate:
+            gate = self.input()
+            self.gates.append((gate, a, b))
+            self.table[key] = gate
+        return gate
+
+    def or_(self, a, b):
+        """
+        Return the disjunction of 'a' and 'b'.
+        """
+        return -self.and_(-a, -b)
+
+    def xor(self, a, b):
+        """
+        Return the exclusive or of 'a' and 'b'.
+        """
+        return self.or_(self.and_(a, -b), self.and_(-a, b))
+
+    def any(self, literals):
+        """
+        Return the disjunction of all literals.
+        """
+        res = self.FALSE
+        for lit in literals:
+            res = self.or_(res, lit)
+        return res
+
+    def assume(self, lit):
+        """
+        Force the literal to be true by a unit clause.
+        """
+        self.units.append(lit)
+
+    def print(self, comment, file=sys.stdout):
+        """
+        Print the Tseitin encoding of all gates and the unit clauses.  The
+        constant 'FALSE' as unit yields the empty clause and 'TRUE' none.
+        """
+        units = [lit for lit in self.units if lit != self.TRUE]
+        print(f"c {comment}", file=file)
+        print(f"p cnf {self.variables} {3 * len(self.gates) + len(units)}", file=file)
+        for gate, a, b in self.gates:
+            print(f"{-gate} {a} 0", file=file)
+            print(f"{-gate} {b} 0", file=file)
+            print(f"{-a} {-b} {gate} 0", file=file)
+        for lit in units:
+            print("0" if lit == self.FALSE else f"{lit} 0", file=file)
+
+
+def full_adder(circuit, a, b, carry):
+    """
+    Return sum and carry out of adding 'a', 'b' and 'carry'.
+    """
+    half = circuit.xor(a, b)
+    total = circuit.xor(half, carry)
+    carry = circuit.or_(circuit.and_(a, b), circuit.and_(half, carry))
+    return total, carry
+
+
+def majority_adder(circuit, a, b, carry):
+    """
+    Alternative full adder with the sum computed right to left and the
+    carry as majority function.
+    """
+    total = circuit.xor(a, circuit.xor(b, carry))
+    carry = circuit.or_(circuit.and_(a, b), circuit.and_(carry, circuit.or_(a, b)))
+    return total, carry
+
+
+def ripple_carry_adder(circuit, a, b, cell=full_adder):
+    """
+    Return the 'len(a) + 1' sum bits of adding 'a' and 'b' (least
+    significant bit first) propagating the carry bit by bit.
+    """
+    carry, sums = circuit.FALSE, []
+    for x, y in zip(a, b):
+        total, carry = cell(circuit, x, y, carry)
+        sums.append(total)
+    return sums + [carry]
+
+
+def kogge_stone_adder(circuit, a, b):
+    """
+    Return the 'len(a) + 1' sum bits of adding 'a' and 'b' computing all
+    carries with a logarithmic depth parallel prefix network.
+    """
+    n = len(a)
+    propagate = [circuit.xor(x, y) for x, y in zip(a, b)]
+    generate = [circuit.and_(x, y) for x, y in zip(a, b)]
+    g, p = list(generate), list(propagate)
+    distance = 1
+    while distance < n:
+        for i in range(n - 1, distance - 1, -1):
+            j = i - distance
+            g[i] = circuit.or_(g[i], circuit.and_(p[i], g[j]))
+            p[i] = circuit.and_(p[i], p[j])
+        distance *= 2
+    sums = [propagate[0]]
+    for i in range(1, n):
+        sums.append(circuit.xor(propagate[i], g[i - 1]))
+    return sums + [g[n - 1]]
+
+
+def inputs(circuit, bits):
+    """
+    Return two operands of 'bits' inputs each.  Their bits are numbered
+    interleaved starting with the least significant bits, as in the shipped
+    instances, since the solvers decide on variables in index order.
+    """
+    a, b = [], []
+    for _ in range(bits):
+        a.append(circuit.input())
+        b.append(circuit.input())
+    return a, b
+
+
+def adder(bits, prefix):
+    """
+    Return the miter circuit of the two adders.
+    """
+    circuit = Circuit()
+    a, b = inputs(circuit, bits)
+    first = ripple_carry_adder(circuit, a, b)
+    if prefix:
+        second = kogge_stone_adder(circuit, a, b)
+    else:
+        second = ripple_carry_adder(circuit, a, b, majority_adder)
+    circuit.assume(circuit.any(circuit.xor(x, y) for x, y in zip(first, second)))
+    return circuit
+
+
+def multiplier(circuit, a, b):
+    """
+    Return the 'len(a) + len(b)' product bits of an array multiplier.
+    """
+    product = [circuit.FALSE] * (len(a) + len(b))
+    for j, y in enumerate(b):
+        row = [circuit.and_(x, y) for x in a] + [circuit.FALSE] * (len(b) - j)
+        window = product[j:]
+        product[j:] = ripple_carry_adder(circuit, window, row[: len(window)])[:-1]
+    return product
+
+
+def factor(number, width):
+    """
+    Return the circuit factoring 'number' into two factors of 'width' bits
+    which are both different from one.
+    """
+    circuit = Circuit()
+    a, b = inputs(circuit, width)
+    for bit, lit in enumerate(multiplier(circuit, a, b)):
+        circuit.assume(lit if number >> bit & 1 else -lit)
+    circuit.assume(circuit.any(a[1:]))
+    circuit.assume(circuit.any(b[1:]))
+    return circuit
+
+
+def is_prime(n):
+    """
+    Deterministic Miller-Rabin primality test (exact up to 3.3e24 and
+    with negligible error probability beyond).
+    """
+    if n < 2:
+        return False
+    bases = [2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41]
+    for p in bases:
+        if n % p == 0:
+            return n == p
+    d, s = n - 1, 0
+    while d % 2 == 0:
+        d, s = d // 2, s + 1
+    for base in bases:
+        x = pow(base, d, n)
+        if x in (1, n - 1):
+            continue
+        for _ in range(s - 1):
+            x = x * x % n
+            if x == n - 1:
+                break
+        else:
+            return False
+    return True
+
+
+def random_prime(bits, rng):
+    """
+    Return a random prime with exactly 'bits' bits.
+    """
+    if bits < 2:
+        raise ValueError("primes need at least two bits")
+    while True:
+        n = rng.getrandbits(bits) | 1 << (bits - 1) | 1
+        if bits == 2:
+            n = rng.choice([2, 3])
+        if is_prime(n):
+            return n
+
+
+def main():
+    """
+    Parse command line options and print the generated CNF.
+    """
+    parser = argparse.ArgumentParser(
+        description="Generate adder and factoring benchmarks in DIMACS format",
+        formatter_class=argparse.RawDescriptionHelpFormatter,
+        epilog=__doc__,
+    )
+    families = parser.add_subparsers(dest="family", required=True)
+
+    adder_parser = families.add_parser("adder", help="adder equivalence miter")
+    adder_parser.add_argument("bits", type=int, help="width of the adders")
+    adder_parser.add_argument(
+        "--kogge-stone", action="store_true", help="use parallel prefix adder"
+    )
+
+    factor_parser = families.add_parser("factor", help="multiplier factoring")
+    group = factor_parser.add_mutually_exclusive_group(required=True)
+    group.add_argument("number", type=int, nargs="?", help="number to factor")
+    group.add_argument("--prime", type=int, metavar="BITS", help="random prime")
+    group.add_argument(
+        "--semiprime", type=int, metavar="BITS", help="random semiprime"
+    )
+    factor_parser.add_argument("--width", type=int, help="width of the factors")
+    factor_parser.add_argument("--seed", type=int, default=0, help="random seed")
+
+    args = parser.parse_args()
+
+    if args.family == "adder":
+        if args.bits < 1:
+            parser.error("expected positive number of bits")
+        kind = "kogge-stone" if args.kogge_stone else "ripple-carry"
+        comment = f"{kind} adder equivalence {args.bits} bits (unsatisfiable)"
+        circuit = adder(args.bits, args.kogge_stone)
+    else:
+        rng = random.Random(args.seed)
+        if args.prime is not None:
+            if args.prime < 2:
+                parser.error("primes need at least two bits")
+            number = random_prime(args.prime, rng)
+        elif args.semiprime is not None:
+            if args.semiprime < 4:
+                parser.error("semiprimes need at least four bits")
+            # The product of the two primes might have one bit less.
+            half = args.semiprime // 2
+            number = 0
+            while number.bit_length() != args.semiprime:
+                number = random_prime(half, rng) * random_prime(
+                    args.semiprime - half, rng
+                )
+        else:
+            number = args.number
+        if number < 2:
+            parser.error("expected number larger than one")
+        width = args.width or max(number.bit_length() - 1, 1)
+        status = "satisfiable" if not is_prime(number) else "unsatisfiable"
+        if args.width:
+            status = "unknown"
+        comment = f"factor {number} with {width} bit factors ({status})"
+        circuit = factor(number, width)
+
+    circuit.print(comment)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,129 @@
+#!/bin/sh
+
+# Regression test runner for the solver engines.  Runs each engine given
+# on the command line (default all working engines) on the CNFs in this
+# directory and checks the exit code against the expected status.  The
+# solver output goes to '<name>-<engine>.log' and '<name>-<engine>.err'.
+#
+# The DPLL engines (including the backjumping engine 'cdcl' without clause
+# learning) time out on the larger adder and factoring instances, which are
+# thus only run for the CDCL engine 'watches' and its packed and scalar
+# builds.  The larger instances are also run with the optional features of
+# 'watches', where the factoring instances are large enough to trigger
+# simplification of learned (and with '--compress' compressed) clauses.
+
+cd `dirname $0`
+
+die () {
+  echo "test.sh: error: $*" 1>&2
+  exit 1
+}
+
+# The largest factoring instance is generated instead of being shipped.
+
+if [ ! -f prime9130651.cnf ]
+then
+  python3 ../cnfgen.py factor --prime 24 --seed 3 > prime9130651.tmp &&
+  mv prime9130651.tmp prime9130651.cnf ||
+  die "could not generate 'prime9130651.cnf'"
+fi
+
+engines="$*"
+[ "$engines" ] || engines="dpll backtrack cdcl watches watches-packed watches-scalar"
+
+ok=0
+failed=0
+
+run () {
+  name=$1
+  expected=$2
+  option=$3
+  solver=../babysat-$engine
+  base=$name-$engine`echo "$option" | sed -e 's/^--*/-/' -e 's/ /-/g'`
+  log=$base.log
+  err=$base.err
+  printf "%s %s" $engine $name
+  [ "$option" ] && printf " %s" $option
+  $solver $option $name.cnf 1>$log 2>$err
+  res=$?
+  if [ $res = $expected ]
+  then
+    ok=`expr $ok + 1`
+    echo " ok (exit code $res)"
+  else
+    failed=`expr $failed + 1`
+    echo " FAILED (exit code $res but expected $expected)"
+  fi
+}
+
+for engine in $engines
+do
+  [ -x ../babysat-$engine ] || die "could not find 'babysat-$engine'"
+
+  run false 20
+  run true 10
+
+  run unit1 10
+  run unit2 10
+  run unit3 10
+  run unit4 10
+  run unit5 20
+  run unit6 20
+  run unit7 10
+  run unit8 20
+  run unit9 20
+  run probe1 10
+
+  run full1 20
+  run full2 20
+  run full3 20
+  run full4 20
+
+  run add4 20
+  run add8 20
+
+  run prime4 10
+  run prime9 10
+  run prime25 10
+  run prime49 10
+  run prime121 10
+  run prime169 10
+  run prime289 10
+  run prime361 10
+  run prime529 10
+  run prime841 10
+  run prime961 10
+  run prime1369 10
+  run prime1681 10
+  run prime1849 10
+  run prime2209 10
+
+  case $engine in
+    dpll|backtrack|cdcl) continue;;
+  esac
+
+  run add16 20
+  run add32 20
+  run add64 20
+  run add128 20
+
+  run prime65537 20
+  run prime4294967297 20
+  run prime9130651 20
+
+  [ $engine = watches ] || continue
+
+  # Probing due right away fixes all variables before the first decision.
+  run probe1 10 "--inprocess-interval 0"
+
+  for option in --compress --renumber --huge-pages
+  do
+    run add128 20 $option
+    run prime65537 20 $option
+    run prime4294967297 20 $option
+    run prime9130651 20 $option
+  done
+done
+
+echo "test.sh: $ok ok, $failed failed"
+[ $failed = 0 ]